@@ -245,7 +245,7 @@ TGroundMap transform_map_back(const TGroundMap &ext_map)
             if (ground_map[y][x] == INNER_TILE) ++num_inner_tiles;
         }
     }
-    std::cout << num_inner_tiles << std::endl;
+    TRACE(ETraceLevel::Info, num_inner_tiles << "\n");
     return ground_map;
 }
 
@@ -2,123 +2,335 @@
 #include <array>
 #include <map>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include <exception>
 
 #include "../utility.h"
 
 using TComb = std::uint64_t;
-using TMemo = std::vector<std::vector<std::vector<TComb>>>;
+__extension__ typedef unsigned __int128 TComb128; // for large unfold factors, whose counts overflow TComb
 
 constexpr char SPRING{ '.' };
 constexpr char DAMAGED_SPRING{ '#' };
 constexpr char UNKNOWN_SPRING{ '?' };
-constexpr TComb INIT_VAL{ std::numeric_limits<TComb>::max() };
+constexpr size_t RECORD_CHUNK_SIZE{ 64u }; // number of records a thread takes at once
+constexpr size_t MIN_RECORDS_PER_THREAD{ 256u }; // smaller record lists are not worth starting threads for
+constexpr size_t UNFOLD_FACTOR{ 5u }; // default unfold factor of part 2, can be changed by --unfold_12=<n>
+constexpr TComb COMB_MOD{ 1000000007u };
+
+// Number of combinations modulo MOD, which never overflows regardless of the unfold factor
+template <TComb MOD>
+struct ModComb
+{
+    TComb val{ 0u };
+    ModComb() = default;
+    ModComb(TComb v) : val{ v % MOD } {};
+    ModComb& operator+=(const ModComb &other)
+    {
+        val += other.val;
+        if (val >= MOD) val -= MOD;
+        return *this;
+    }
+};
+
+using TPart2Comb = TComb128; // count type of part 2: TComb, TComb128 or ModComb<COMB_MOD>
 
 struct ConditionRecord
 {
-    std::string springs;
-    std::vector<int> groups; 
+    std::string springs{};
+    std::vector<int> groups{};
+};
+
+// Scratch buffers of the DP, which are only growing so they can be reused for all records without allocations
+template <typename TCount>
+struct DpScratch
+{
+    std::vector<TCount> cur_row{};
+    std::vector<TCount> nxt_row{};
+    std::vector<size_t> damaged_run{};
+    void reserve(size_t n_springs)
+    {
+        if (cur_row.size() > n_springs) return;
+        cur_row.resize(n_springs+1u);
+        nxt_row.resize(n_springs+1u);
+        damaged_run.resize(n_springs+1u);
+    }
 };
 
 std::vector<ConditionRecord> get_records(const std::string &file_path);
-TComb get_comb_dp(const std::string &springs, int pos, const std::vector<int> &groups, int g_pos, int cur_count, TMemo &memo_3d);
-std::vector<ConditionRecord> unfold_records(const std::vector<ConditionRecord> &records);
+template <typename TCount>
+TCount get_comb_num(const std::string &springs, const std::vector<int> &groups, DpScratch<TCount> &scratch);
+std::vector<ConditionRecord> unfold_records(const std::vector<ConditionRecord> &records, size_t unfold_factor);
+void unfold_record(const ConditionRecord &record, size_t unfold_factor, ConditionRecord &unfolded_record);
+template <typename TCount>
+TCount get_comb_sum(const std::vector<ConditionRecord> &records, size_t unfold_factor, size_t n_threads);
+void benchmark_comb_widths(const std::vector<ConditionRecord> &records);
+std::string comb_to_string(TComb combs);
+std::string comb_to_string(TComb128 combs);
+template <TComb MOD>
+std::string comb_to_string(ModComb<MOD> combs);
+template <typename TCount>
+bool add_overflows(TCount &combs, const TCount &other);
+template <TComb MOD>
+bool add_overflows(ModComb<MOD> &combs, const ModComb<MOD> &other);
+template <typename TCount>
+void benchmark_comb_width(const std::vector<ConditionRecord> &records, size_t unfold_factor, const std::string &type_name);
 
 TComb sol_12_1(const std::string &file_path)
 {
     std::vector<ConditionRecord> records = get_records(file_path);
-    TComb combs{ 0ull };
 
-    for (const auto &rec : records)
+    return get_comb_sum<TComb>(records, 1u, std::max(1u, std::thread::hardware_concurrency()));
+}
+
+
+/**
+ * @brief Counts with TPart2Comb, which is not streamable for TComb128, so the count is returned as string
+ * 
+ * @throws std::invalid_argument if the unfold factor is 0
+ * @throws std::overflow_error if the count does not fit into TPart2Comb
+ */
+std::string sol_12_2(const std::string &file_path)
+{
+    std::vector<ConditionRecord> records = get_records(file_path);
+    if ("1" == get_program_option("bench_12", "0")) benchmark_comb_widths(records);
+    const size_t unfold_factor{ std::stoul(get_program_option("unfold_12", std::to_string(UNFOLD_FACTOR))) };
+    if (unfold_factor == 0u)
     {
-        int max_group_val{ 0 };
-        for (const auto & group : rec.groups)
-        {
-            if (group > max_group_val) max_group_val = group;
-        }
-        TMemo memo_3d(rec.springs.length(),std::vector<std::vector<TComb>>(rec.groups.size()+1,std::vector<TComb>(max_group_val+1,INIT_VAL)));
-        combs += get_comb_dp(rec.springs, 0, rec.groups, 0, 0,memo_3d);
+        throw std::invalid_argument("sol_12_2: The unfold factor has to be at least 1");
     }
 
-    return combs;
+    return comb_to_string(get_comb_sum<TPart2Comb>(records, unfold_factor, std::max(1u, std::thread::hardware_concurrency())));
 }
 
-
-TComb sol_12_2(const std::string &file_path)
+/*
+Idea: the records are independent of each other, so the threads take chunks of RECORD_CHUNK_SIZE records
+until all records are processed. Each thread owns its DP scratch buffers and unfolds the records one at a time
+into its own reusable record, so neither the DP nor the unfolding allocates once the buffers have grown.
+The partial sums are added up after joining the threads.
+Throws std::overflow_error if the sum does not fit into TCount, an overflow in a thread is rethrown after joining.
+*/
+template <typename TCount>
+TCount get_comb_sum(const std::vector<ConditionRecord> &records, size_t unfold_factor, size_t n_threads)
 {
-    std::vector<ConditionRecord> records = get_records(file_path);
-    records = unfold_records(records);
-    TComb combs{ 0ull };
+    n_threads = std::max(size_t{ 1u }, std::min(n_threads, records.size()/MIN_RECORDS_PER_THREAD));
+    std::vector<TCount> thread_combs(n_threads, TCount{ 0u });
+    std::vector<std::exception_ptr> thread_errors(n_threads);
+    std::atomic<size_t> nxt_chunk{ 0u };
 
-    for (const auto &rec : records)
+    auto worker = [&](size_t t)
     {
-        int max_group_val{ 0 };
-        for (const auto & group : rec.groups)
+        try
         {
-            if (group > max_group_val) max_group_val = group;
+            DpScratch<TCount> scratch{};
+            ConditionRecord unfolded_record{};
+            TCount combs{ 0u };
+            bool has_overflow{ false };
+            for (size_t first=RECORD_CHUNK_SIZE*nxt_chunk++; first<records.size(); first=RECORD_CHUNK_SIZE*nxt_chunk++)
+            {
+                const size_t last{ std::min(first+RECORD_CHUNK_SIZE, records.size()) };
+                for (size_t r=first; r<last; ++r)
+                {
+                    if (unfold_factor > 1u)
+                    {
+                        unfold_record(records[r], unfold_factor, unfolded_record);
+                        has_overflow |= add_overflows(combs, get_comb_num(unfolded_record.springs, unfolded_record.groups, scratch));
+                    }
+                    else
+                    {
+                        has_overflow |= add_overflows(combs, get_comb_num(records[r].springs, records[r].groups, scratch));
+                    }
+                }
+            }
+            if (has_overflow) throw std::overflow_error("get_comb_sum: The sum of combinations overflows the count type");
+            thread_combs[t] = combs;
         }
-        TMemo memo_3d(rec.springs.length(),std::vector<std::vector<TComb>>(rec.groups.size()+1,std::vector<TComb>(max_group_val+1,INIT_VAL)));
-        combs += get_comb_dp(rec.springs, 0, rec.groups, 0, 0,memo_3d);
+        catch (...)
+        {
+            thread_errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t=1; t<n_threads; ++t)
+    {
+        threads.emplace_back(worker, t);
+    }
+    worker(0u);
+    for (auto &t : threads)
+    {
+        t.join();
     }
 
+    for (const auto &error : thread_errors)
+    {
+        if (error) std::rethrow_exception(error);
+    }
+
+    TCount combs{ 0u };
+    bool has_overflow{ false };
+    for (const auto &thread_comb : thread_combs)
+    {
+        has_overflow |= add_overflows(combs, thread_comb);
+    }
+    if (has_overflow) throw std::overflow_error("get_comb_sum: The sum of combinations overflows the count type");
     return combs;
 }
 
+/**
+ * @brief Times part 2 for several unfold factors with each counting type (enabled by --bench_12=1).
+ * TComb overflows for large factors, TComb128 is exact for longer and ModComb never overflows.
+ */
+void benchmark_comb_widths(const std::vector<ConditionRecord> &records)
+{
+    for (size_t unfold_factor : { size_t{ 5u }, size_t{ 10u }, size_t{ 20u } })
+    {
+        benchmark_comb_width<TComb>(records, unfold_factor, "uint64: ");
+        benchmark_comb_width<TComb128>(records, unfold_factor, "uint128:");
+        benchmark_comb_width<ModComb<COMB_MOD>>(records, unfold_factor, "mod " + std::to_string(COMB_MOD) + ":");
+    }
+}
 
-TComb get_comb_dp(const std::string &springs, int pos, const std::vector<int> &groups, int g_pos, int cur_count, TMemo &memo_3d)
+template <typename TCount>
+void benchmark_comb_width(const std::vector<ConditionRecord> &records, size_t unfold_factor, const std::string &type_name)
 {
+    const size_t n_threads{ std::max(1u, std::thread::hardware_concurrency()) };
+    std::cout << "Unfold x" << unfold_factor << " " << type_name << " ";
+    try
+    {
+        auto res = funcTime<TCount>(get_comb_sum<TCount>, records, unfold_factor, n_threads);
+        std::cout << comb_to_string(res.second) << " in " << res.first << " ns" << std::endl;
+    }
+    catch (const std::overflow_error &)
+    {
+        std::cout << "overflow" << std::endl;
+    }
+}
+
+std::string comb_to_string(TComb combs)
+{
+    return std::to_string(combs);
+}
 
-    // check for validity
-    if (g_pos == groups.size() && cur_count > 0) return 0;
-    if (cur_count > 0 && cur_count > groups[g_pos]) return 0;
-    if (pos == springs.size())
+std::string comb_to_string(TComb128 combs)
+{
+    std::string digits{};
+    do
     {
-        if (g_pos == groups.size() && cur_count == 0 || g_pos == (groups.size()-1) && cur_count==groups[g_pos])
-        {
-            return 1; // valid case
-        }
-        else return 0;
+        digits += static_cast<char>('0' + static_cast<int>(combs % 10u));
+        combs /= 10u;
+    } while (combs > 0u);
+    return { digits.rbegin(), digits.rend() };
+}
+
+template <TComb MOD>
+std::string comb_to_string(ModComb<MOD> combs)
+{
+    return std::to_string(combs.val);
+}
+
+/**
+ * @brief Adds other to combs and returns true if the unsigned sum wrapped around
+ */
+template <typename TCount>
+bool add_overflows(TCount &combs, const TCount &other)
+{
+    combs += other;
+    return combs < other;
+}
+
+// counting modulo MOD never overflows
+template <TComb MOD>
+bool add_overflows(ModComb<MOD> &combs, const ModComb<MOD> &other)
+{
+    combs += other;
+    return false;
+}
+
+
+/*
+Idea: bottom-up DP over (group, pos), where a row holds for each pos the number of arrangements of
+groups[g..] within springs[pos..]. Row g only depends on row g+1, so two rows are sufficient:
+- springs[pos] may be operational -> all arrangements of groups[g..] starting at pos+1
+- group g may start at pos, if the run of possibly damaged springs starting at pos is long enough and
+  the spring after the group is not damaged -> all arrangements of groups[g+1..] starting behind that spring
+The run lengths are precomputed once per record, so each record costs O(len*groups).
+Throws std::overflow_error if a count does not fit into TCount.
+*/
+template <typename TCount>
+TCount get_comb_num(const std::string &springs, const std::vector<int> &groups, DpScratch<TCount> &scratch)
+{
+    const size_t n{ springs.size() };
+    scratch.reserve(n);
+    TCount *cur = scratch.cur_row.data();
+    TCount *nxt = scratch.nxt_row.data();
+    size_t *damaged_run = scratch.damaged_run.data();
+
+    damaged_run[n] = 0u;
+    for (size_t pos=n; pos-- > 0u;)
+    {
+        damaged_run[pos] = (springs[pos] == SPRING) ? 0u : damaged_run[pos+1u]+1u;
     }
 
-    // check memo
-    if (memo_3d[pos][g_pos][cur_count] != INIT_VAL) return memo_3d[pos][g_pos][cur_count];
+    // no groups left: valid as long as no damaged spring follows
+    nxt[n] = TCount{ 1u };
+    for (size_t pos=n; pos-- > 0u;)
+    {
+        nxt[pos] = (springs[pos] == DAMAGED_SPRING) ? TCount{ 0u } : nxt[pos+1u];
+    }
 
-    TComb r1{ 0 };
-    if (springs[pos] == SPRING || springs[pos] == UNKNOWN_SPRING)
+    bool has_overflow{ false };
+    for (size_t g=groups.size(); g-- > 0u;)
     {
-        if (cur_count > 0) // end current group
-        {
-            if (cur_count == groups[g_pos]) r1 = get_comb_dp(springs, pos+1,groups,g_pos+1,0, memo_3d);
-        }
-        else // no group was active
+        const size_t group_len{ static_cast<size_t>(groups[g]) };
+        cur[n] = TCount{ 0u };
+        for (size_t pos=n; pos-- > 0u;)
         {
-            r1 = get_comb_dp(springs, pos+1,groups,g_pos,0, memo_3d);
+            TCount combs{ (springs[pos] != DAMAGED_SPRING) ? cur[pos+1u] : TCount{ 0u } };
+            const size_t group_end{ pos+group_len };
+            if (damaged_run[pos] >= group_len && (group_end == n || springs[group_end] != DAMAGED_SPRING))
+            {
+                has_overflow |= add_overflows(combs, nxt[std::min(group_end+1u, n)]);
+            }
+            cur[pos] = combs;
         }
+        std::swap(cur, nxt);
     }
-    TComb r2{ 0 };
-    if (springs[pos] == DAMAGED_SPRING || springs[pos] == UNKNOWN_SPRING)
-    {
-        r2 = get_comb_dp(springs, pos+1,groups,g_pos,cur_count+1, memo_3d);
-    }
+    if (has_overflow) throw std::overflow_error("get_comb_num: The number of combinations overflows the count type");
 
-    return memo_3d[pos][g_pos][cur_count] = r1 + r2;
+    return nxt[0];
 }
 
-std::vector<ConditionRecord> unfold_records(const std::vector<ConditionRecord> &records)
+std::vector<ConditionRecord> unfold_records(const std::vector<ConditionRecord> &records, size_t unfold_factor)
 {
-    std::vector<ConditionRecord> new_records{ records };
+    std::vector<ConditionRecord> new_records(records.size());
 
     for (size_t r=0; r<new_records.size(); ++r)
     {
-        for (int i=0; i<4; ++i)
-        {
-            new_records[r].groups.insert(new_records[r].groups.begin(), records[r].groups.begin(), records[r].groups.end());
-            new_records[r].springs += UNKNOWN_SPRING + records[r].springs;
-        }
+        unfold_record(records[r], unfold_factor, new_records[r]);
     }
 
     return new_records;
 }
 
+/**
+ * @brief Writes the unfold_factor times unfolded record into unfolded_record, whose buffers are reused
+ */
+void unfold_record(const ConditionRecord &record, size_t unfold_factor, ConditionRecord &unfolded_record)
+{
+    unfolded_record.springs.assign(record.springs);
+    unfolded_record.groups.assign(record.groups.begin(), record.groups.end());
+    for (size_t i=1; i<unfold_factor; ++i)
+    {
+        unfolded_record.springs += UNKNOWN_SPRING;
+        unfolded_record.springs += record.springs;
+        unfolded_record.groups.insert(unfolded_record.groups.end(), record.groups.begin(), record.groups.end());
+    }
+}
+
 std::vector<ConditionRecord> get_records(const std::string &file_path)
 {
     std::vector<ConditionRecord> records;
@@ -21,13 +21,13 @@ RockFormation tilt_east(const RockFormation &rock);
 uint32_t calc_load(const RockFormation &rock);
 void do_cycle(RockFormation &rock);
 
-void print_rock(const RockFormation &rock);
+std::ostream& print_rock(const RockFormation &rock, std::ostream &out);
 
 int sol_14_1(const std::string &file_path)
 {
     RockFormation rock_form = read_string_vec_from_file(file_path);
     auto tilted_rock_form = tilt_north(rock_form);
-    print_rock(tilted_rock_form);
+    if (trace_enabled(ETraceLevel::Debug)) print_rock(tilted_rock_form, TraceSink::get().stream());
     return calc_load(tilted_rock_form);
 }
 
@@ -190,12 +190,13 @@ RockFormation tilt_east(const RockFormation &rock)
     return new_rock;
 }
 
-void print_rock(const RockFormation &rock)
+std::ostream& print_rock(const RockFormation &rock, std::ostream &out)
 {
-    std::cout << "\n";
+    out << "\n";
 
     for (const auto & row : rock)
     {
-        std::cout << row << std::endl;
+        out << row << "\n";
     }
+    return out;
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <array>
 #include <map>
 #include <numeric>
+#include <bitset>
+#include <cstring>
+#include <algorithm>
 
 #include "../utility.h"
 
@@ -16,16 +19,35 @@ namespace
     constexpr char VERT_SPLITTER{ '|' };
     constexpr char HOR_SPLITTER{ '-' };
 
-    using TDir = int;
+    using TDir = std::uint8_t;
     constexpr TDir LEFT{ 1u<<0 }; // Indicates light beam has entered from left
     constexpr TDir BELOW{ 1u<<1 }; // Indicates light beam has entered from tile below
     constexpr TDir RIGHT{ 1u<<2 }; // Indicates light beam has entered from right tile
     constexpr TDir ABOVE{ 1u<<3 }; // Indicates light beam has entered from upper tile
 
+    // Head of a light beam: the tile it is about to enter and the side it enters from
+    struct Beam
+    {
+        int row{};
+        int col{};
+        TDir entering_dir{};
+    };
+
+    // Contiguous row-major grid holding one direction bitmask per tile
+    struct BeamTrack
+    {
+        int n_row{};
+        int n_col{};
+        std::vector<TDir> tiles{};
+        BeamTrack(size_t rows, size_t cols) : n_row{ static_cast<int>(rows) }, n_col{ static_cast<int>(cols) }, tiles(rows*cols, 0u) {};
+        void reset() { std::fill(tiles.begin(), tiles.end(), TDir{ 0u }); }
+    };
+
 };
 
-void trace_light_beam(int row, int col, TDir entering_dir, const TSquare<std::string> &mirr_square, TSquare<std::vector<TDir>> &beam_track_square);
-std::uint32_t count_energized_tiles(const TSquare<std::vector<TDir>> &beam_track_square);
+void trace_light_beam(int row, int col, TDir entering_dir, const TSquare<std::string> &mirr_square, BeamTrack &beam_track, std::vector<Beam> &beam_stack);
+Beam get_next_beam(const Beam &beam, TDir entering_dir);
+std::uint32_t count_energized_tiles(const BeamTrack &beam_track);
 std::uint32_t get_max_beam_configuration(const TSquare<std::string> &mirr_square);
 template <typename T>
 void print_square(const TSquare<T> &beam_track_square);
@@ -33,10 +55,11 @@ void print_square(const TSquare<T> &beam_track_square);
 int sol_16_1(const std::string &file_path)
 {
     TSquare<std::string> orig_square = read_string_vec_from_file(file_path);
-    TSquare<std::vector<TDir>> beam_track_square(orig_square.size(), std::vector<TDir>(orig_square[0].length(), 0u));
+    BeamTrack beam_track(orig_square.size(), orig_square[0].length());
+    std::vector<Beam> beam_stack{};
 
-    trace_light_beam(0,0,LEFT, orig_square, beam_track_square);
-    return count_energized_tiles(beam_track_square);
+    trace_light_beam(0,0,LEFT, orig_square, beam_track, beam_stack);
+    return static_cast<int>(count_energized_tiles(beam_track));
 }
 
 
@@ -44,40 +67,37 @@ int sol_16_2(const std::string &file_path)
 {
     TSquare<std::string> orig_square = read_string_vec_from_file(file_path);
 
-    return get_max_beam_configuration(orig_square);
+    return static_cast<int>(get_max_beam_configuration(orig_square));
 }
 
 std::uint32_t get_max_beam_configuration(const TSquare<std::string> &mirr_square)
 {
     std::uint32_t max_energized_tiles{ 0ul };
-    auto r_num{ mirr_square.size() };
-    auto c_num{ mirr_square[0].length() };
+    int r_num{ static_cast<int>(mirr_square.size()) };
+    int c_num{ static_cast<int>(mirr_square[0].length()) };
+
+    // track grid and beam stack are allocated once and reused for every entry configuration
+    BeamTrack beam_track(mirr_square.size(), mirr_square[0].length());
+    std::vector<Beam> beam_stack{};
+    beam_stack.reserve(mirr_square.size() + mirr_square[0].length());
+    auto check_config = [&](int row, int col, TDir entering_dir)
+    {
+        beam_track.reset();
+        trace_light_beam(row, col, entering_dir, mirr_square, beam_track, beam_stack);
+        max_energized_tiles = std::max(max_energized_tiles, count_energized_tiles(beam_track));
+    };
 
     // check all left-side tiles and right-side tiles
-    for (size_t row=0; row<r_num; ++row)
+    for (int row=0; row<r_num; ++row)
     {
-        TSquare<std::vector<TDir>> beam_track_square(r_num, std::vector<TDir>(c_num, 0u));
-        trace_light_beam(row,0,LEFT, mirr_square, beam_track_square);
-        auto energized_tiles = count_energized_tiles(beam_track_square);
-        if (energized_tiles > max_energized_tiles) max_energized_tiles = energized_tiles;
-        // check righ side
-        beam_track_square = TSquare<std::vector<TDir>>(r_num, std::vector<TDir>(c_num, 0u));
-        trace_light_beam(row,c_num-1,RIGHT, mirr_square, beam_track_square);
-        energized_tiles = count_energized_tiles(beam_track_square);
-        if (energized_tiles > max_energized_tiles) max_energized_tiles = energized_tiles;
+        check_config(row, 0, LEFT);
+        check_config(row, c_num-1, RIGHT);
     }
-    // check all bottom and top tiles
-    for (size_t col=0; col<c_num; ++col)
+    // check all top tiles and beams coming in from bottom
+    for (int col=0; col<c_num; ++col)
     {
-        TSquare<std::vector<TDir>> beam_track_square(r_num, std::vector<TDir>(c_num, 0u));
-        trace_light_beam(0,col,ABOVE, mirr_square, beam_track_square);
-        auto energized_tiles = count_energized_tiles(beam_track_square);
-        if (energized_tiles > max_energized_tiles) max_energized_tiles = energized_tiles;
-        // check beams coming in from bottom
-        beam_track_square = TSquare<std::vector<TDir>>(r_num, std::vector<TDir>(c_num, 0u));
-        trace_light_beam(r_num-1,col,BELOW, mirr_square, beam_track_square);
-        energized_tiles = count_energized_tiles(beam_track_square);
-        if (energized_tiles > max_energized_tiles) max_energized_tiles = energized_tiles;
+        check_config(0, col, ABOVE);
+        check_config(r_num-1, col, BELOW);
     }
 
     return max_energized_tiles;
@@ -90,109 +110,125 @@ Idea is to trace each beam until it ends. An end corresponds to:
 - entering a tile, where a light beam already passed in the exact same direction
 A duplicate 2D-grid tracks the path of each light beam by using a 4-bit num for each tile.
 Each of the for bits stands for one direction and if this bit is true, at least one light beam
-has already entered the tile from this direction 
+has already entered the tile from this direction.
+Instead of recursing for every tile, the current beam is followed in a loop and only the second
+half of a split beam is pushed onto an explicit stack, so the trace depth is independent of the grid size.
 */
-void trace_light_beam(int row, int col, TDir entering_dir, const TSquare<std::string> &mirr_square, TSquare<std::vector<TDir>> &beam_track_square)
+void trace_light_beam(int row, int col, TDir entering_dir, const TSquare<std::string> &mirr_square, BeamTrack &beam_track, std::vector<Beam> &beam_stack)
 {
-    // check for valid row, col values
-    if (row < 0 || row >= mirr_square.size() || col < 0 || col >= mirr_square[row].size()) return;
-
-    // check if this tile has already been entered from current direction -> stop here for this beam's path is already known
-    if (beam_track_square[row][col] & entering_dir) return;
-    
-    // add this new direction to tile
-    beam_track_square[row][col] |= entering_dir;
+    beam_stack.clear();
+    beam_stack.push_back({ row, col, entering_dir });
 
-    // continue to neihboring tiles based on current tiles symbol
-    if (LEFT == entering_dir)
-    {
-        switch (mirr_square[row][col])
-        {
-        case VERT_SPLITTER:
-            trace_light_beam(row+1,col,ABOVE, mirr_square, beam_track_square);
-            trace_light_beam(row-1,col,BELOW, mirr_square, beam_track_square);
-            break;
-        case SLASH:
-            trace_light_beam(row-1,col,BELOW, mirr_square, beam_track_square);
-            break;
-        case BACK_SLASH:
-            trace_light_beam(row+1,col,ABOVE, mirr_square, beam_track_square);
-            break;        
-        default: // continue to the right
-            trace_light_beam(row,col+1,entering_dir, mirr_square, beam_track_square);
-            break;
-        }
-    }
-    if (RIGHT == entering_dir)
-    {
-        switch (mirr_square[row][col])
-        {
-        case VERT_SPLITTER:
-            trace_light_beam(row+1,col,ABOVE, mirr_square, beam_track_square);
-            trace_light_beam(row-1,col,BELOW, mirr_square, beam_track_square);
-            break;
-        case SLASH:
-            trace_light_beam(row+1,col,ABOVE, mirr_square, beam_track_square);
-            break;
-        case BACK_SLASH:
-            trace_light_beam(row-1,col,BELOW, mirr_square, beam_track_square);
-            break;        
-        default: // continue to the left
-            trace_light_beam(row,col-1,entering_dir, mirr_square, beam_track_square);
-            break;
-        }
-    }
-    if (ABOVE == entering_dir)
+    while (!beam_stack.empty())
     {
-        switch (mirr_square[row][col])
+        Beam beam = beam_stack.back();
+        beam_stack.pop_back();
+
+        while (true)
         {
-        case HOR_SPLITTER:
-            trace_light_beam(row,col+1,LEFT, mirr_square, beam_track_square);
-            trace_light_beam(row,col-1,RIGHT, mirr_square, beam_track_square);
-            break;
-        case SLASH:
-            trace_light_beam(row,col-1,RIGHT, mirr_square, beam_track_square);
-            break;
-        case BACK_SLASH:
-            trace_light_beam(row,col+1,LEFT, mirr_square, beam_track_square);
-            break;        
-        default: // go on downwards
-            trace_light_beam(row+1,col,entering_dir, mirr_square, beam_track_square);
-            break;
+            // check for valid row, col values
+            if (beam.row < 0 || beam.row >= beam_track.n_row || beam.col < 0 || beam.col >= beam_track.n_col) break;
+
+            // check if this tile has already been entered from current direction -> stop here for this beam's path is already known
+            TDir &tile = beam_track.tiles[static_cast<size_t>(beam.row)*static_cast<size_t>(beam_track.n_col) + static_cast<size_t>(beam.col)];
+            if (tile & beam.entering_dir) break;
+
+            // add this new direction to tile
+            tile |= beam.entering_dir;
+
+            // determine the entering direction(s) of the neighboring tile(s) based on current tiles symbol
+            TDir next_dir{ beam.entering_dir };
+            TDir split_dir{ 0u };
+            const char symbol{ mirr_square[static_cast<size_t>(beam.row)][static_cast<size_t>(beam.col)] };
+            if (LEFT == beam.entering_dir || RIGHT == beam.entering_dir)
+            {
+                switch (symbol)
+                {
+                case VERT_SPLITTER:
+                    next_dir = ABOVE;
+                    split_dir = BELOW;
+                    break;
+                case SLASH:
+                    next_dir = (LEFT == beam.entering_dir) ? BELOW : ABOVE;
+                    break;
+                case BACK_SLASH:
+                    next_dir = (LEFT == beam.entering_dir) ? ABOVE : BELOW;
+                    break;
+                default: // continue in the same direction
+                    break;
+                }
+            }
+            else
+            {
+                switch (symbol)
+                {
+                case HOR_SPLITTER:
+                    next_dir = LEFT;
+                    split_dir = RIGHT;
+                    break;
+                case SLASH:
+                    next_dir = (ABOVE == beam.entering_dir) ? RIGHT : LEFT;
+                    break;
+                case BACK_SLASH:
+                    next_dir = (ABOVE == beam.entering_dir) ? LEFT : RIGHT;
+                    break;
+                default: // continue in the same direction
+                    break;
+                }
+            }
+
+            if (split_dir)
+            {
+                beam_stack.push_back(get_next_beam(beam, split_dir));
+            }
+            beam = get_next_beam(beam, next_dir);
         }
     }
-    if (BELOW == entering_dir)
+}
+
+/**
+ * @brief Returns the beam head on the neighboring tile, which is entered from the given direction
+ * e.g. entering a tile from LEFT means the beam has moved one column to the right
+ */
+Beam get_next_beam(const Beam &beam, TDir entering_dir)
+{
+    switch (entering_dir)
     {
-        switch (mirr_square[row][col])
-        {
-        case HOR_SPLITTER:
-            trace_light_beam(row,col+1,LEFT, mirr_square, beam_track_square);
-            trace_light_beam(row,col-1,RIGHT, mirr_square, beam_track_square);
-            break;
-        case SLASH:
-            trace_light_beam(row,col+1,LEFT, mirr_square, beam_track_square);
-            break;
-        case BACK_SLASH:
-            trace_light_beam(row,col-1,RIGHT, mirr_square, beam_track_square);
-            break;        
-        default: // go on upwards
-            trace_light_beam(row-1,col,entering_dir, mirr_square, beam_track_square);
-            break;
-        }
+    case LEFT:
+        return { beam.row, beam.col+1, entering_dir };
+    case RIGHT:
+        return { beam.row, beam.col-1, entering_dir };
+    case ABOVE:
+        return { beam.row+1, beam.col, entering_dir };
+    default: // BELOW
+        return { beam.row-1, beam.col, entering_dir };
     }
-
 }
 
-std::uint32_t count_energized_tiles(const TSquare<std::vector<TDir>> &beam_track_square)
+/**
+ * @brief Counts all tiles that have been entered from at least one direction.
+ * The track grid is processed in 8-byte words: each non-zero byte is folded into its
+ * most significant bit, so a single popcount yields the number of energized tiles per word.
+ */
+std::uint32_t count_energized_tiles(const BeamTrack &beam_track)
 {
+    constexpr std::uint64_t LOW_7_BITS{ 0x7F7F7F7F7F7F7F7Full };
+    constexpr std::uint64_t HIGH_BIT{ 0x8080808080808080ull };
     std::uint32_t num_energ_tiles{ 0ul };
 
-    for (const auto &row : beam_track_square)
+    const TDir *tiles = beam_track.tiles.data();
+    size_t n_tiles{ beam_track.tiles.size() };
+    size_t i{ 0u };
+    for (; i+sizeof(std::uint64_t)<=n_tiles; i+=sizeof(std::uint64_t))
     {
-        for (const auto &tile : row)
-        {
-            if (tile > 0u) ++num_energ_tiles;
-        }
+        std::uint64_t word;
+        std::memcpy(&word, tiles+i, sizeof(word));
+        std::uint64_t non_zero = (((word & LOW_7_BITS) + LOW_7_BITS) | word) & HIGH_BIT;
+        num_energ_tiles += static_cast<std::uint32_t>(std::bitset<64>(non_zero).count());
+    }
+    for (; i<n_tiles; ++i)
+    {
+        if (tiles[i] > 0u) ++num_energ_tiles;
     }
 
     return num_energ_tiles;
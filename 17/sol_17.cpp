@@ -60,7 +60,7 @@ int sol_17_1(const std::string &file_path)
     Node start{ 0,0,EDir::Right, MAX_NUM_STRAIGHTS,0 };
     
     auto shortest_path = funcTime<int>(getShortestPath,start,file_path);
-    std::cout << "Duration: " << shortest_path.first << " ns" << std::endl;
+    TRACE(ETraceLevel::Info, "Duration: " << shortest_path.first << " ns\n");
 
     return shortest_path.second;
 }
@@ -74,11 +74,11 @@ int sol_17_2(const std::string &file_path)
     // lead to an immediate turn to right and once with heading Left, which
     // will lead to an immediate left turn and the path starts downwards 
     auto shortest_path_right = funcTime<int>(getShortestPath_2,start,file_path);
-    std::cout << "Duration: " << shortest_path_right.first << " ns" << std::endl;
+    TRACE(ETraceLevel::Info, "Duration: " << shortest_path_right.first << " ns\n");
 
     start.dir = EDir::Left;
     auto shortest_path_down = funcTime<int>(getShortestPath_2,start,file_path);
-    std::cout << "Duration: " << shortest_path_down.first << " ns" << std::endl;
+    TRACE(ETraceLevel::Info, "Duration: " << shortest_path_down.first << " ns\n");
 
     // workaround to detect paths that do not end at expected destination
     if (shortest_path_down.second == -1) return shortest_path_right.second;
@@ -260,7 +260,7 @@ namespace Day18
             */
            if (r1.start_row == -6575698)
            {
-                std::cout << "found" << std::endl;
+                TRACE(ETraceLevel::Debug, "found\n");
            }
             if (range_queue.size() > 0 && (range_queue.top().start_row<r1.end_row && range_queue.top().start_row<r2.end_row) &&
                 range_queue.top().start_col > r1.start_col && range_queue.top().end_col < r2.start_col)
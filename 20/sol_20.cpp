@@ -1,16 +1,18 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <queue>
-#include <memory>
 #include <numeric>
+#include <tuple>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 
 #include "../utility.h"
 
 namespace Day20
 {
-    class Module;
-    using TModPtr = std::unique_ptr<Module>;
+    using TModId = std::uint16_t;
+    __extension__ typedef __int128 TWide; // products of moduli in combine_congruences exceed 64 bits
 
     constexpr char FlipFlopSymbol{ '%' };
     constexpr char ConjunctionSymbol{ '&' };
@@ -20,59 +22,55 @@ namespace Day20
         Low=0,
         High
     };
-    struct Pulse
+    enum class EModuleType : std::uint8_t
     {
-        std::string src{}; 
-        EPulseType type{};
-        std::vector<std::string> targets{};
+        Broadcaster,
+        FlipFlop,
+        Conjunction,
+        Sink // modules without definition in the input (e.g. rx, output) and the button
     };
 
-    class Module
+    // Pulse of the compiled network, each pulse has exactly one target
+    struct CompiledPulse
     {
-    public:
-        virtual Pulse process_pulse(const Pulse &pulse);
-        virtual void add_input(const std::string &name) { ; }
-        virtual void print_state() const { ; }
-        virtual std::vector<std::string> get_targets() const { return targets; }
-        Module(const std::string &n, const std::vector<std::string> &t) : name{n}, targets{t} {};
-        virtual ~Module() = default;
-    protected:
-        std::string name{};
-        std::vector<std::string> targets{};
+        TModId src{};
+        TModId dst{};
+        std::uint32_t mem_bit{}; // state bit of dst that remembers the last pulse from src (only used for conjunctions)
+        EPulseType type{};
     };
 
-    class FlipFlop : public Module
+    // Connection from a module to one of its targets
+    struct Wire
     {
-    public:
-        FlipFlop(const std::string &n, const std::vector<std::string> &t) : Module(n,t) {};
-        void print_state() const override { ; }
-        void add_input(const std::string &name) override { ; }
-        std::vector<std::string> get_targets() const override { return targets; }
-        Pulse process_pulse(const Pulse &pulse) override;
-        virtual ~FlipFlop() = default;
-    private:
-        bool state{ 0 }; // FlipFlops are initially in state off
+        TModId dst{};
+        std::uint32_t mem_bit{};
     };
 
-    class Conjunction : public Module
+    // FIFO ring buffer for pulses, its capacity is doubled whenever it is full, so after the first few
+    // button presses no more allocations happen
+    class PulseQueue
     {
     public:
-        Conjunction(const std::string &n, const std::vector<std::string> &t) : Module(n,t) {};
-        void add_input(const std::string &name) override { memory[name] = EPulseType::Low; }
-        void print_state() const override;
-        std::vector<std::string> get_targets() const override { return targets; }
-        Pulse process_pulse(const Pulse &pulse) override;
-        virtual ~Conjunction() = default;
+        bool empty() const { return head == tail; }
+        void clear() { head = tail = 0u; }
+        void push(const CompiledPulse &p)
+        {
+            if (tail - head == buffer.size()) grow();
+            buffer[tail++ & (buffer.size()-1u)] = p;
+        }
+        const CompiledPulse& pop() { return buffer[head++ & (buffer.size()-1u)]; }
     private:
-        std::unordered_map<std::string,EPulseType> memory{ }; // Conjunction remembers the last pulse type for each input (init is low)
-        int num_high{ 0 };
-    };
-
-    class ModuleFactory 
-    {
-    public: 
-        virtual TModPtr create_module(const std::string &name,const std::vector<std::string> &targets);
-        virtual ~ModuleFactory() = default;
+        void grow()
+        {
+            std::vector<CompiledPulse> new_buffer(buffer.size()*2u);
+            for (size_t i=0; head+i<tail; ++i) new_buffer[i] = buffer[(head+i) & (buffer.size()-1u)];
+            tail -= head;
+            head = 0u;
+            buffer.swap(new_buffer);
+        }
+        std::vector<CompiledPulse> buffer = std::vector<CompiledPulse>(64u); // size is always a power of 2
+        size_t head{ 0u };
+        size_t tail{ 0u };
     };
 
     struct PulseCnt{
@@ -80,254 +78,429 @@ namespace Day20
         uint32_t HighCnt{};
     };
 
+    struct SimulationResult
+    {
+        std::uint64_t low_cnt{};
+        std::uint64_t high_cnt{};
+        std::uint64_t presses{}; // number of simulated button presses
+        bool stopped{ false }; // true if the observer stopped the simulation early
+    };
+
     class ModuleConfig
     {
     public:
-        std::pair<PulseCnt,bool> get_pulse_num_after_button_press(size_t cnt);
+        std::pair<PulseCnt,bool> get_pulse_num_after_button_press();
         ModuleConfig(const std::vector<std::string> &data_in);
         std::unordered_map<std::string,std::pair<EPulseType,std::vector<size_t>>> track_changes(size_t btn_presses, const std::vector<std::string> &tracked_modules);
         std::vector<std::string> get_inputs(const std::string &m) const;
+        std::uint64_t get_presses_until_low_pulse(const std::string &sink, size_t max_presses);
+        template<typename Observer>
+        SimulationResult simulate(std::uint64_t n_presses, Observer &&observer);
+        SimulationResult simulate(std::uint64_t n_presses);
+        void reset();
     private:
-        std::unordered_map<std::string,TModPtr> mod_map;
-        std::unordered_map<std::string,std::pair<EPulseType,std::vector<size_t>>> change_tracker; // this map tracks for multiple Modules the button presses that lead to a change in their output
+        void compile_network(const std::vector<std::string> &data_in);
+        template<typename Observer>
+        void press_button(Observer &&on_pulse);
+        bool get_state_bit(std::uint32_t bit) const { return (state[bit/64u] >> (bit%64u)) & 1u; }
+        void set_state_bit(std::uint32_t bit, bool val);
+
+        // compiled network: modules are identified by their index, targets of module i are stored in 
+        // wires[wire_offsets[i]..wire_offsets[i+1]) and all module states are packed into one bitset
+        std::unordered_map<std::string,TModId> mod_ids{};
+        std::vector<std::string> mod_names{};
+        std::vector<EModuleType> mod_types{};
+        std::vector<std::uint32_t> wire_offsets{};
+        std::vector<Wire> wires{};
+        std::vector<std::uint32_t> state_bit{}; // flip-flop: on/off bit, conjunction: first memory bit
+        std::vector<std::uint16_t> num_inputs{}; // number of inputs of each conjunction
+        std::vector<std::uint16_t> num_high_inputs{}; // number of inputs of each conjunction that last sent a high pulse
+        std::vector<std::uint64_t> state{};
+        PulseQueue pulse_queue{};
+        TModId button_id{};
+        TModId broadcaster_id{};
+        TModId rx_id{};
     };
 
     int sol_20_1(const std::string &file_path)
     {
         auto data_in = read_string_vec_from_file(file_path);
         ModuleConfig mod_config(data_in);
-        std::pair<PulseCnt,bool> pulse_nums{ {0,0}, false };
-        for (int i=0; i<1000; ++i)
-        {
-            auto res = mod_config.get_pulse_num_after_button_press(i);
-            pulse_nums.first.LowCnt += res.first.LowCnt;
-            pulse_nums.first.HighCnt += res.first.HighCnt;
-        }
+        auto res = mod_config.simulate(1000);
 
-        return pulse_nums.first.LowCnt * pulse_nums.first.HighCnt;
+        return static_cast<int>(res.low_cnt * res.high_cnt);
     }
 
 
     /*
     The module configuration states that rx is a unique output of a conjunction module -> we need to find the button press that will 
     lead to all inputs of this conjunction module to be High. 
-    This is achieved by tracking the number of button presses that will lead to a High pulse for each conjunction input.
-    After analysing this data, one can see that (at least for my input) this resulted in 4 modules to be tracked and they always transmitted a high
-    pulse after a cyclic number of button presses. In the same cycle the High pulse is also followed by a low pulse -> we need to find the least common
-    multiple (lcm) of all High pulse cycle counts
+    Each of these inputs is driven by an independent sub-counter that sends a High pulse periodically, see get_presses_until_low_pulse
     */
     size_t sol_20_2(const std::string &file_path)
     {
         auto data_in = read_string_vec_from_file(file_path);
         ModuleConfig mod_config(data_in);
-        
-        std::vector<std::string> rx_in = mod_config.get_inputs("rx");
-        std::vector<std::string> rx_remote_in;
-        for (const auto &in : rx_in)
+
+        return mod_config.get_presses_until_low_pulse("rx", 100'000);
+    }
+
+    /**
+     * @brief Combines two congruences x = r1 (mod m1) and x = r2 (mod m2) into x = r (mod lcm(m1,m2)) 
+     * (Chinese remainder theorem for moduli that are not necessarily coprime)
+     * 
+     * @throws std::runtime_error if the congruences contradict each other
+     * @throws std::overflow_error if lcm(m1,m2) does not fit into 64 bits
+     */
+    std::pair<std::int64_t,std::int64_t> combine_congruences(std::int64_t r1, std::int64_t m1, std::int64_t r2, std::int64_t m2)
+    {
+        // extended euclid: g = gcd(m1,m2) = m1*x + m2*y
+        std::int64_t old_r{ m1 }, r{ m2 }, old_x{ 1 }, x{ 0 };
+        while (r != 0)
         {
-            auto res = mod_config.get_inputs(in);
-            rx_remote_in.insert(rx_remote_in.end(), res.begin(), res.end());
+            std::int64_t q = old_r / r;
+            std::swap(old_r, r);
+            r -= q*old_r;
+            std::swap(old_x, x);
+            x -= q*old_x;
         }
-        auto tracker = mod_config.track_changes(100'000, rx_remote_in);
-
-        // calc least common multiple of the respective cycle times
-        std::uint64_t lcm_res{ 1 };
-        for (const auto &track : tracker)
+        const std::int64_t g{ old_r };
+        if ((r2 - r1) % g != 0)
         {
-            lcm_res = std::lcm(lcm_res,track.second.second[1]+1); // +1 is added since cycles are counted from 0 onwards
+            throw std::runtime_error("combine_congruences: No button press fulfills all periods");
         }
-
-        return lcm_res;
+        const std::int64_t m2_g{ m2 / g };
+        const TWide lcm{ TWide{ m1 } * m2_g };
+        if (lcm > std::numeric_limits<std::int64_t>::max())
+        {
+            throw std::overflow_error("combine_congruences: The combined period exceeds 64 bits");
+        }
+        const TWide k{ ((TWide{ (r2 - r1) / g % m2_g } * (old_x % m2_g)) % m2_g + m2_g) % m2_g };
+        return { static_cast<std::int64_t>(((r1 + m1*k) % lcm + lcm) % lcm), static_cast<std::int64_t>(lcm) };
     }
 
+    /*
+    Tracks for each module in tracked_modules the button presses (counted from 0) after which its output pulse type changed.
+    Runs on the compiled network: the last output type and the tracker slot of each module are stored in flat arrays
+    indexed by module id, the change timestamps of all modules are appended to one flat array. The result map is
+    only assembled once at the end, so the cost per press does not depend on any string lookups.
+    Each entry of the result starts with press 0 (initial state Low) for compatibility with the manual analysis
+    */
     std::unordered_map<std::string,std::pair<EPulseType,std::vector<size_t>>> ModuleConfig::track_changes(size_t btn_presses, const std::vector<std::string> &tracked_modules) 
     {
-        change_tracker.clear();
-        for (const auto &mod : tracked_modules)
+        constexpr std::uint32_t NOT_TRACKED{ std::numeric_limits<std::uint32_t>::max() };
+        std::vector<std::uint32_t> tracker_slot(mod_types.size(), NOT_TRACKED);
+        std::vector<EPulseType> last_type(tracked_modules.size(), EPulseType::Low);
+        std::vector<std::uint32_t> change_slots; // tracker slot of the module of each change 
+        std::vector<std::uint64_t> change_presses; // button press of each change
+        for (std::uint32_t slot=0; slot<tracked_modules.size(); ++slot)
         {
-            change_tracker[mod].first = EPulseType::Low;
-            change_tracker[mod].second = { 0 };
+            tracker_slot[mod_ids.at(tracked_modules[slot])] = slot;
         }
-        for (size_t i; i<btn_presses; ++i)
-        {
-            Pulse start_pulse{ "Button",EPulseType::Low,{ "broadcaster" } };
-            std::queue<Pulse> unprocessed_pulses;
-            unprocessed_pulses.push(start_pulse);
 
-            while (!unprocessed_pulses.empty())
+        reset();
+        simulate(btn_presses, [&](std::uint64_t press, const CompiledPulse &p)
+        {
+            const std::uint32_t slot{ tracker_slot[p.src] };
+            if (NOT_TRACKED != slot && p.type != last_type[slot])
             {
-                auto nxt_pulse = unprocessed_pulses.front();
-                unprocessed_pulses.pop();
-
-                // compare with tracker
-                auto it = change_tracker.find(nxt_pulse.src);
-                if (it != change_tracker.end() && nxt_pulse.type != it->second.first)
-                {
-                    it->second.second.push_back(i);
-                    it->second.first = nxt_pulse.type;
-                }
-
-                for (const auto &target : nxt_pulse.targets)
-                {
-                    if (target == "output") continue;
-                    if (target == "rx") continue;
-
-                    auto new_pulse = mod_map.at(target)->process_pulse(nxt_pulse);
-                    unprocessed_pulses.push(new_pulse);
-                }
+                last_type[slot] = p.type;
+                change_slots.push_back(slot);
+                change_presses.push_back(press-1u);
             }
+            return false;
+        });
+
+        std::unordered_map<std::string,std::pair<EPulseType,std::vector<size_t>>> change_tracker;
+        for (std::uint32_t slot=0; slot<tracked_modules.size(); ++slot)
+        {
+            change_tracker[tracked_modules[slot]] = { last_type[slot], { 0 } };
+        }
+        for (size_t c=0; c<change_slots.size(); ++c)
+        {
+            change_tracker[tracked_modules[change_slots[c]]].second.push_back(change_presses[c]);
         }
         return change_tracker;
     }
 
 
-    std::pair<PulseCnt,bool> ModuleConfig::get_pulse_num_after_button_press(size_t cnt)
+    /*
+    Automated version of the manual analysis of the module graph:
+    1. Walk back from the sink to the single conjunction feeding it. The sink receives a low pulse, once all
+       inputs of this conjunction have sent a High pulse within the same button press
+    2. Simulate the network once and record the button presses in which each conjunction input sends a High pulse
+       until each input has done this three times. The first occurrence is the offset, the distance between the
+       first two is the period, the third occurrence validates the period
+    3. Combine all (offset, period) pairs via the chinese remainder theorem (LCM if the offsets equal the periods)
+    This needs O(max period) button presses instead of simulating until the sink receives a low pulse.
+    */
+    std::uint64_t ModuleConfig::get_presses_until_low_pulse(const std::string &sink, size_t max_presses)
     {
-        std::uint32_t num_low_pulses{ 0ul };
-        std::uint32_t num_high_pulses{ 0ul };
+        constexpr size_t NUM_OCCURRENCES{ 3u };
+        const TModId sink_id{ mod_ids.at(sink) };
 
-        Pulse start_pulse{ "Button",EPulseType::Low,{ "broadcaster" } };
-        std::queue<Pulse> unprocessed_pulses;
-        unprocessed_pulses.push(start_pulse);
-        bool rx_low_received{ false };
-
-        while (!unprocessed_pulses.empty())
+        std::vector<TModId> feeders;
+        for (TModId id=0; id<mod_types.size(); ++id)
         {
-            auto nxt_pulse = unprocessed_pulses.front();
-            unprocessed_pulses.pop();
-
-            for (const auto &target : nxt_pulse.targets)
+            for (std::uint32_t w=wire_offsets[id]; w<wire_offsets[id+1u]; ++w)
             {
-                // increase respective pulse counter
-                if (nxt_pulse.type == EPulseType::High) ++num_high_pulses;
-                else ++num_low_pulses;
+                if (wires[w].dst == sink_id) feeders.push_back(id);
+            }
+        }
+        if (feeders.size() != 1u || EModuleType::Conjunction != mod_types[feeders[0]])
+        {
+            throw std::runtime_error("get_presses_until_low_pulse: " + sink + " has to be fed by a single conjunction");
+        }
+        const TModId conj_id{ feeders[0] };
 
-                // skip special pulse targets -> they do not exist in mod_map
-                if (target == "output") continue;
-                if (target == "rx") continue;
+        // high_presses[i] holds the presses in which the conjunction input with memory bit state_bit[conj_id]+i sent High
+        std::vector<std::vector<std::uint64_t>> high_presses(num_inputs[conj_id]);
+        size_t num_complete{ 0u };
+        reset();
+        simulate(max_presses, [&](std::uint64_t press, const CompiledPulse &p)
+        {
+            if (p.dst == conj_id && EPulseType::High == p.type)
+            {
+                auto &presses = high_presses[p.mem_bit - state_bit[conj_id]];
+                if (presses.size() < NUM_OCCURRENCES && (presses.empty() || presses.back() != press))
+                {
+                    presses.push_back(press);
+                    if (presses.size() == NUM_OCCURRENCES) ++num_complete;
+                }
+            }
+            return num_complete == high_presses.size();
+        });
+        if (num_complete < high_presses.size())
+        {
+            throw std::runtime_error("get_presses_until_low_pulse: No periods found within " + std::to_string(max_presses) + " button presses");
+        }
 
-                auto new_pulse = mod_map.at(target)->process_pulse(nxt_pulse);
-                unprocessed_pulses.push(new_pulse);
+        std::int64_t res{ 0 };
+        std::int64_t modulus{ 1 };
+        std::int64_t max_offset{ 0 };
+        for (const auto &presses : high_presses)
+        {
+            const std::int64_t offset{ static_cast<std::int64_t>(presses[0]) };
+            const std::int64_t period{ static_cast<std::int64_t>(presses[1] - presses[0]) };
+            if (presses[2] - presses[1] != presses[1] - presses[0])
+            {
+                throw std::runtime_error("get_presses_until_low_pulse: Input of the conjunction is not periodic");
             }
+            std::tie(res, modulus) = combine_congruences(res, modulus, offset % period, period);
+            max_offset = std::max(max_offset, offset);
         }
+        // smallest press that is not before any first occurrence
+        if (res < max_offset) res += (max_offset - res + modulus - 1) / modulus * modulus;
+        reset();
 
-        return { PulseCnt{ num_low_pulses,num_high_pulses }, rx_low_received };
+        return static_cast<std::uint64_t>(res);
     }
 
-    std::vector<std::string> ModuleConfig::get_inputs(const std::string &m) const
+    // Sets all modules of the compiled network back to their initial state
+    void ModuleConfig::reset()
     {
-        std::vector<std::string> inputs;
-        for (const auto & mod : mod_map)
+        std::fill(state.begin(), state.end(), std::uint64_t{ 0u });
+        std::fill(num_high_inputs.begin(), num_high_inputs.end(), std::uint16_t{ 0u });
+    }
+
+    /*
+    Processes a single button press on the compiled network. Each pulse in the queue has a single target,
+    which keeps the processing order of the original multi-target pulses (all targets of a pulse are 
+    queued consecutively). No strings are involved and the queue storage is reused for all presses
+    */
+    template<typename Observer>
+    void ModuleConfig::press_button(Observer &&on_pulse)
+    {
+        pulse_queue.clear();
+        pulse_queue.push({ button_id, broadcaster_id, 0u, EPulseType::Low });
+        while (!pulse_queue.empty())
         {
-            for (const auto &t : mod.second->get_targets())
+            const CompiledPulse p = pulse_queue.pop();
+            on_pulse(p);
+
+            EPulseType out_type{ p.type };
+            switch (mod_types[p.dst])
             {
-                if (m == t) inputs.push_back(mod.first);
+            case EModuleType::Broadcaster:
+                break;
+            case EModuleType::FlipFlop:
+            {
+                if (EPulseType::High == p.type) continue;
+                const bool on = !get_state_bit(state_bit[p.dst]);
+                set_state_bit(state_bit[p.dst], on);
+                out_type = on ? EPulseType::High : EPulseType::Low;
+                break;
+            }
+            case EModuleType::Conjunction:
+                if (get_state_bit(p.mem_bit) != static_cast<bool>(p.type))
+                {
+                    set_state_bit(p.mem_bit, p.type);
+                    if (EPulseType::High == p.type) ++num_high_inputs[p.dst];
+                    else --num_high_inputs[p.dst];
+                }
+                out_type = (num_high_inputs[p.dst] == num_inputs[p.dst]) ? EPulseType::Low : EPulseType::High;
+                break;
+            default: // sinks do not send any pulses
+                continue;
+            }
+
+            for (std::uint32_t w=wire_offsets[p.dst]; w<wire_offsets[p.dst+1u]; ++w)
+            {
+                pulse_queue.push({ p.dst, wires[w].dst, wires[w].mem_bit, out_type });
             }
         }
-        return inputs;
     }
 
-    Pulse Module::process_pulse(const Pulse &pulse)
-    { 
-        return { name, pulse.type,targets };
-    }
-    Pulse FlipFlop::process_pulse(const Pulse &pulse)
+    /**
+     * @brief Simulates n_presses button presses in a row (continuing from the current module states) and counts all pulses
+     * 
+     * @param n_presses maximum number of button presses
+     * @param observer called for each pulse as bool(std::uint64_t press, const CompiledPulse &pulse), presses are counted from 1.
+     * Once it returns true, the simulation stops after the current button press
+     * @return SimulationResult 
+     */
+    template<typename Observer>
+    SimulationResult ModuleConfig::simulate(std::uint64_t n_presses, Observer &&observer)
     {
-        if (pulse.type == EPulseType::High) 
+        std::uint64_t num_pulses[2]{ 0ull, 0ull }; // indexed by EPulseType
+        SimulationResult res{};
+        for (std::uint64_t press=1; press<=n_presses && !res.stopped; ++press)
         {
-            return {}; // no pulse will be transmitted since neither src nor any targets are set
-        }
-        else
-        {
-            Pulse out_pulse{ name, EPulseType::High, targets };
-            state = !state; // flip state
-            if (state == 0)
-            { // if the state is switched from on to off -> transmit low pulse
-                out_pulse.type = EPulseType::Low;
-            }
-            return out_pulse;
+            press_button([&](const CompiledPulse &p)
+            {
+                ++num_pulses[p.type];
+                if (observer(press, p)) res.stopped = true;
+            });
+            res.presses = press;
         }
+        res.low_cnt = num_pulses[EPulseType::Low];
+        res.high_cnt = num_pulses[EPulseType::High];
+        return res;
     }
-    Pulse Conjunction::process_pulse(const Pulse &pulse)
+
+    SimulationResult ModuleConfig::simulate(std::uint64_t n_presses)
     {
-        // 1. Update memory for current input and count of high mem entries
-        // Note: if this src is not present in the memoryc, it is created with Low
-        if (memory[pulse.src] != pulse.type)
+        return simulate(n_presses, [](std::uint64_t, const CompiledPulse&) { return false; });
+    }
+
+    std::pair<PulseCnt,bool> ModuleConfig::get_pulse_num_after_button_press()
+    {
+        std::uint32_t num_pulses[2]{ 0ul, 0ul }; // indexed by EPulseType
+        bool rx_low_received{ false };
+
+        press_button([&](const CompiledPulse &p)
         {
-            memory[pulse.src] = pulse.type;
-            if (pulse.type == EPulseType::High) ++num_high;
-            else --num_high;
-        }
-        // 2. 
-        if (num_high == memory.size()) return { name,EPulseType::Low,targets };
-        else return { name,EPulseType::High,targets };
+            ++num_pulses[p.type];
+            if (p.dst == rx_id && EPulseType::Low == p.type) rx_low_received = true;
+        });
+
+        return { PulseCnt{ num_pulses[EPulseType::Low], num_pulses[EPulseType::High] }, rx_low_received };
     }
 
-    ModuleConfig::ModuleConfig(const std::vector<std::string> &data_in)
+    /*
+    Parses the module configuration directly into integer module ids and flat arrays:
+    - wire_offsets/wires hold the targets of all modules back to back
+    - each flip-flop gets one state bit, each conjunction one memory bit per input
+    */
+    void ModuleConfig::compile_network(const std::vector<std::string> &data_in)
     {
-        ModuleFactory factory{};
-        std::unordered_map<std::string,std::vector<std::string>> target_src_map;
+        std::vector<std::vector<std::string>> mod_targets;
+        auto get_id = [&](const std::string &name)
+        {
+            auto it = mod_ids.find(name);
+            if (it != mod_ids.end()) return it->second;
+            TModId id = static_cast<TModId>(mod_types.size());
+            mod_ids[name] = id;
+            mod_names.push_back(name);
+            mod_types.push_back(EModuleType::Sink);
+            mod_targets.emplace_back();
+            return id;
+        };
+
+        button_id = get_id("button");
         for (const auto &mod_str : data_in)
         {
             auto in_out_split = split_string(mod_str," -> ");
-            auto target_split = split_string(in_out_split[1],", ");
-            auto name = in_out_split[0].substr(1);
-            if ("broadcaster" == in_out_split[0]) name = in_out_split[0];
-            std::vector<std::string> targets;
-            for (const auto &t : target_split) 
+            auto name = in_out_split[0];
+            EModuleType type{ EModuleType::Broadcaster };
+            if (FlipFlopSymbol == name[0]) type = EModuleType::FlipFlop;
+            if (ConjunctionSymbol == name[0]) type = EModuleType::Conjunction;
+            if (EModuleType::Broadcaster != type) name = name.substr(1);
+            else if ("broadcaster" != name) throw std::runtime_error("compile_network: invalid module type!");
+
+            TModId id = get_id(name);
+            mod_types[id] = type;
+            mod_targets[id] = split_string(in_out_split[1],", ");
+            for (const auto &t : mod_targets[id]) get_id(t);
+        }
+        broadcaster_id = get_id("broadcaster");
+        rx_id = get_id("rx");
+
+        // assign state bits: one per flip-flop, conjunction memory bits are assigned while creating the wires
+        const size_t n_mod{ mod_types.size() };
+        state_bit.assign(n_mod, 0u);
+        num_inputs.assign(n_mod, 0u);
+        num_high_inputs.assign(n_mod, 0u);
+        std::uint32_t nxt_bit{ 0u };
+        for (size_t id=0; id<n_mod; ++id)
+        {
+            if (EModuleType::FlipFlop == mod_types[id]) state_bit[id] = nxt_bit++;
+        }
+        for (size_t id=0; id<n_mod; ++id)
+        {
+            for (const auto &t : mod_targets[id])
             {
-                targets.push_back(t);
-                target_src_map[t].push_back(name);
+                if (EModuleType::Conjunction == mod_types[mod_ids[t]]) ++num_inputs[mod_ids[t]];
+            }
+        }
+        for (size_t id=0; id<n_mod; ++id)
+        {
+            if (EModuleType::Conjunction == mod_types[id])
+            {
+                state_bit[id] = nxt_bit;
+                nxt_bit += num_inputs[id];
             }
-            mod_map[name] = factory.create_module(in_out_split[0],targets);
         }
 
-        // create output module
-        mod_map["output"] = std::make_unique<Module>("output",std::vector<std::string>{});
-
-        // add memory entries in conjunction modules
-        for (const auto &target : target_src_map)
+        std::vector<std::uint16_t> nxt_input(n_mod, 0u);
+        wire_offsets.assign(n_mod+1u, 0u);
+        for (size_t id=0; id<n_mod; ++id)
         {
-            // apparently some module targets are not defined as input
-            auto it = mod_map.find(target.first);
-            if (it != mod_map.end())
+            for (const auto &t : mod_targets[id])
             {
-                for (const auto &src : target.second)
-                mod_map[target.first]->add_input(src);
+                const TModId dst{ mod_ids[t] };
+                const bool is_conj{ EModuleType::Conjunction == mod_types[dst] };
+                wires.push_back({ dst, is_conj ? state_bit[dst] + nxt_input[dst]++ : 0u });
             }
+            wire_offsets[id+1u] = static_cast<std::uint32_t>(wires.size());
         }
+        state.assign(nxt_bit/64u + 1u, 0u);
     }
 
-    TModPtr ModuleFactory::create_module(const std::string &name, const std::vector<std::string> &targets)
+    void ModuleConfig::set_state_bit(std::uint32_t bit, bool val)
     {
-        if ("broadcaster" == name)
-        {
-            return std::make_unique<Module>(name,targets);
-        }
-        else
+        const std::uint64_t mask{ std::uint64_t{ 1u } << (bit%64u) };
+        if (val) state[bit/64u] |= mask;
+        else state[bit/64u] &= ~mask;
+    }
+
+    std::vector<std::string> ModuleConfig::get_inputs(const std::string &m) const
+    {
+        const TModId dst{ mod_ids.at(m) };
+        std::vector<std::string> inputs;
+        for (size_t id=0; id<mod_types.size(); ++id)
         {
-            switch (name[0])
+            for (std::uint32_t w=wire_offsets[id]; w<wire_offsets[id+1u]; ++w)
             {
-            case FlipFlopSymbol:
-                return std::make_unique<FlipFlop>(name.substr(1),targets);
-                break;
-            case ConjunctionSymbol:
-                return std::make_unique<Conjunction>(name.substr(1),targets);                
-                break;
-            default:
-                throw std::runtime_error("create_module: invalid module type!");
-                break;
+                if (wires[w].dst == dst) inputs.push_back(mod_names[id]);
             }
         }
+        return inputs;
     }
 
-    void Conjunction::print_state() const 
+    ModuleConfig::ModuleConfig(const std::vector<std::string> &data_in)
     {
-        for (const auto &elem : memory)
-        {
-            std::cout << elem.first << " - " << (elem.second==EPulseType::High) << std::endl;
-        }
-        std::cout << "\n";
+        compile_network(data_in);
     }
 
 }
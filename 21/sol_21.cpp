@@ -1,19 +1,65 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <queue>
+#include <algorithm>
+#include <bitset>
 
 #include "../utility.h"
 
 namespace Day21
 {
+    using TDist = int32_t;
+
     constexpr char GARDEN_PLOT{ '.' };
     constexpr char ROCK{ '#' };
     constexpr char START_POS{ 'S' };
     constexpr char REACHABLE{ 'O' };
+    constexpr TDist UNREACHABLE{ -1 };
+    constexpr size_t PART_2_STEPS{ 26501365u };
+    constexpr size_t WORD_BITS{ 64u };
+
+    // Minimum number of steps from a start position to each tile, stored row-major
+    struct DistanceMap
+    {
+        size_t n_row{};
+        size_t n_col{};
+        TDist max_dist{ 0 };
+        std::vector<TDist> dist{};
+    };
+
+    /*
+    Bit-parallel representation of the garden: each row is split into 64-bit words with column c stored
+    in bit c%64 of word c/64. One empty row above and below the garden avoid bound checks in the step kernel
+    */
+    struct BitGarden
+    {
+        size_t n_row{};
+        size_t n_col{};
+        size_t n_words{}; // words per row
+        std::vector<uint64_t> plots{}; // bit is set for every tile which is not a rock
+        std::vector<uint64_t> reachable{}; // bit is set for every plot reachable after the current number of steps
+        std::vector<uint64_t> next_reachable{};
+    };
 
     uint32_t mark_reachable_plots(const std::vector<std::string> &garden, size_t steps);
-    std::vector<std::string> do_single_step(const std::vector<std::string> &garden, const std::vector<std::string> &empty_garden);
+    Point<int> get_start_pos(const std::vector<std::string> &garden);
+    DistanceMap get_distance_map(const std::vector<std::string> &garden, const Point<int> &start);
+    std::vector<uint64_t> get_reachable_counts(const DistanceMap &dist_map);
+    uint64_t get_reachable_num(const std::vector<uint64_t> &reach_counts, size_t steps);
+    uint64_t get_reachable_num_tiled(const std::vector<std::string> &garden, size_t steps);
+    uint64_t get_reachable_num_diamond(const std::vector<std::string> &garden, size_t steps);
+    uint64_t get_reachable_num_quadratic(const std::vector<std::string> &garden, size_t steps);
+    uint64_t get_reachable_num_brute_force(const std::vector<std::string> &garden, size_t steps);
+    uint64_t get_reachable_num_stepwise(const std::vector<std::string> &garden, const Point<int> &start, size_t steps);
+    BitGarden get_bit_garden(const std::vector<std::string> &garden, const Point<int> &start);
+    void do_single_step(BitGarden &bit_garden);
+    uint64_t count_reachable_plots(const BitGarden &bit_garden);
+    std::vector<std::string> get_tiled_garden(const std::vector<std::string> &garden, size_t steps, Point<int> &start);
+    bool is_diamond_decomposable(const std::vector<std::string> &garden, size_t steps);
+    void cross_check_tiled(const std::vector<std::string> &garden, size_t max_steps);
     std::ostream& print_garden(const std::vector<std::string> &garden, std::ostream& out);
+    std::ostream& print_garden(const BitGarden &bit_garden, std::ostream& out);
 
     uint32_t sol_21_1(const std::string &file_path)
     {
@@ -24,81 +70,390 @@ namespace Day21
     }
 
 
-    int sol_21_2(const std::string &file_path)
+    uint64_t sol_21_2(const std::string &file_path)
+    {
+        std::vector<std::string> garden = read_string_vec_from_file(file_path);
+        // --cross_check_21=1 compares the tiled step counter against brute force for small budgets
+        if ("1" == get_program_option("cross_check_21", "0"))
+        {
+            cross_check_tiled(garden, 3*garden.size());
+        }
+
+        return get_reachable_num_tiled(garden, PART_2_STEPS);
+    }
+
+    /*
+    A plot is reachable in exactly k steps if its shortest distance d from S is <= k and d has the same
+    parity as k: every remaining even number of steps can be spent by walking back and forth between
+    two neighboring plots. The distances are computed once by a BFS, afterwards any number of step 
+    queries can be answered from the per-parity prefix counts.
+    */
+    uint32_t mark_reachable_plots(const std::vector<std::string> &garden, size_t steps)
     {
+        DistanceMap dist_map = get_distance_map(garden, get_start_pos(garden));
+        std::vector<uint64_t> reach_counts = get_reachable_counts(dist_map);
+
+        return static_cast<uint32_t>(get_reachable_num(reach_counts, steps));
+    }
 
-        return 0;
+    Point<int> get_start_pos(const std::vector<std::string> &garden)
+    {
+        for (size_t row=0; row<garden.size(); ++row)
+        {
+            auto col = garden[row].find(START_POS);
+            if (col != std::string::npos)
+            {
+                return { static_cast<int>(row), static_cast<int>(col) };
+            }
+        }
+        throw std::runtime_error("get_start_pos: No start position found in garden!");
     }
 
-    std::vector<std::string> do_single_step(const std::vector<std::string> &garden, const std::vector<std::string> &empty_garden)
+    /**
+     * @brief Runs a BFS from start and returns the minimum number of steps needed to reach each tile
+     * Rocks and tiles that cannot be reached are set to UNREACHABLE
+     * 
+     * @param garden 2D map of garden plots and rocks
+     * @param start position (row, col) where the BFS starts, has to be a garden plot
+     * @return DistanceMap 
+     */
+    DistanceMap get_distance_map(const std::vector<std::string> &garden, const Point<int> &start)
     {
-        std::vector<std::string> g_out{ empty_garden };
-        static std::vector<Point<int>> dirs{ {1,0},{0,1},{-1,0},{0,-1} };
-        int n_row{ garden.size() };
-        int n_col{ garden.at(0).size() };
+        static const std::vector<Point<int>> dirs{ {1,0},{0,1},{-1,0},{0,-1} };
+        DistanceMap dist_map{ garden.size(), garden.at(0).size(), 0, {} };
+        dist_map.dist.assign(dist_map.n_row*dist_map.n_col, UNREACHABLE);
+        const int n_row{ static_cast<int>(dist_map.n_row) };
+        const int n_col{ static_cast<int>(dist_map.n_col) };
 
-        for (int row=0; row<n_row; ++row)
+        std::queue<Point<int>> q;
+        dist_map.dist[static_cast<size_t>(start.x)*dist_map.n_col + static_cast<size_t>(start.y)] = 0;
+        q.push(start);
+        while (!q.empty())
         {
-            for (int col=0; col<n_col; ++col)
+            Point<int> cur = q.front();
+            q.pop();
+            TDist cur_dist = dist_map.dist[static_cast<size_t>(cur.x)*dist_map.n_col + static_cast<size_t>(cur.y)];
+            dist_map.max_dist = cur_dist;
+            for (const auto &dir : dirs)
             {
-                if (REACHABLE == garden.at(row).at(col))
+                auto c_row = cur.x+dir.x;
+                auto c_col = cur.y+dir.y;
+                if (c_row < 0 || c_row >= n_row || c_col < 0 || c_col >= n_col || 
+                    garden[static_cast<size_t>(c_row)][static_cast<size_t>(c_col)] == ROCK) continue;
+
+                TDist &nxt_dist = dist_map.dist[static_cast<size_t>(c_row)*dist_map.n_col + static_cast<size_t>(c_col)];
+                if (UNREACHABLE == nxt_dist)
                 {
-                    for (const auto &dir : dirs)
-                    {
-                        auto c_row = row+dir.x;
-                        auto c_col = col+dir.y;
-                        if (c_row >= 0 && c_row<n_row && c_col>=0 && c_col<n_col && g_out[c_row][c_col] != ROCK)
-                        {
-                            g_out[c_row][c_col] = REACHABLE;
-                        }
-                    }
+                    nxt_dist = cur_dist + 1;
+                    q.push({ c_row, c_col });
                 }
             }
         }
 
-        return g_out;
+        return dist_map;
     }
 
-    uint32_t mark_reachable_plots(const std::vector<std::string> &garden, size_t steps)
+    /**
+     * @brief Counts for each number of steps k in [0, max_dist] the number of plots reachable in exactly k steps
+     * 
+     * @param dist_map result of a BFS over the garden
+     * @return std::vector<uint64_t> element k holds the number of plots with dist <= k and dist%2 == k%2
+     */
+    std::vector<uint64_t> get_reachable_counts(const DistanceMap &dist_map)
     {
-        std::vector<std::string> empty_garden{ garden };
-        std::vector<std::string> cur_reach_pos{ garden };
+        std::vector<uint64_t> reach_counts(static_cast<size_t>(dist_map.max_dist)+1u, 0u);
+        for (const auto d : dist_map.dist)
+        {
+            if (UNREACHABLE != d) ++reach_counts[static_cast<size_t>(d)];
+        }
+        // accumulate over all distances with the same parity
+        for (size_t k=2; k<reach_counts.size(); ++k)
+        {
+            reach_counts[k] += reach_counts[k-2];
+        }
+        return reach_counts;
+    }
 
-        // create one empty garden and one were the start symbol is replaced by a REACHABLE symbol
-        for (int row=0; row<garden.size(); ++row)
+    uint64_t get_reachable_num(const std::vector<uint64_t> &reach_counts, size_t steps)
+    {
+        if (steps < reach_counts.size()) return reach_counts[steps];
+        // all plots are within reach, only the parity decides 
+        size_t last_idx{ reach_counts.size()-1u };
+        if ((steps - last_idx) % 2 != 0u)
         {
-            for (int col=0; col<garden.at(0).size(); ++col)
+            if (last_idx == 0u) return 0u;
+            --last_idx;
+        }
+        return reach_counts[last_idx];
+    }
+
+    /**
+     * @brief Returns the number of plots reachable in exactly steps on the infinitely repeated garden
+     * Uses the diamond decomposition if the garden has the required structure, otherwise falls back to
+     * quadratic extrapolation (large budgets) or brute force (small budgets)
+     */
+    uint64_t get_reachable_num_tiled(const std::vector<std::string> &garden, size_t steps)
+    {
+        if (is_diamond_decomposable(garden, steps))
+        {
+            return get_reachable_num_diamond(garden, steps);
+        }
+        if (steps <= 8u*std::max(garden.size(), garden.at(0).size()))
+        {
+            return get_reachable_num_brute_force(garden, steps);
+        }
+        return get_reachable_num_quadratic(garden, steps);
+    }
+
+    /*
+    The diamond decomposition requires a square garden of odd size N with S in its center, free center 
+    row/column and free borders, and steps = N/2 + w*N. Then every tile is entered either through the 
+    middle of an edge or through a corner at a known step count, so only 9 BFS runs on a single tile are
+    needed (center, 4 edge midpoints, 4 corners):
+    - Full tiles inside the diamond alternate between odd and even parity
+    - The 4 tips of the diamond are entered from the edge midpoint with N-1 steps left
+    - Along each diagonal edge there are w+1 small (N/2-1 steps left) and w large (3N/2-1 steps left) 
+      corner tiles
+    */
+    uint64_t get_reachable_num_diamond(const std::vector<std::string> &garden, size_t steps)
+    {
+        const size_t n{ garden.size() };
+        const int last{ static_cast<int>(n)-1 };
+        const int mid{ static_cast<int>(n/2u) };
+        const uint64_t tiles_w{ steps/n - 1u }; // number of full tiles in each direction apart from the center tile
+        auto fill = [&garden](int row, int col, size_t s)
+        {
+            return get_reachable_num(get_reachable_counts(get_distance_map(garden, { row, col })), s);
+        };
+
+        // full tiles: the center tile has the same parity as steps, neighboring tiles alternate (N is odd)
+        const uint64_t center_parity_tiles{ (tiles_w/2u*2u + 1u)*(tiles_w/2u*2u + 1u) };
+        const uint64_t other_parity_tiles{ ((tiles_w+1u)/2u*2u)*((tiles_w+1u)/2u*2u) };
+        uint64_t reachable_num = center_parity_tiles*fill(mid, mid, 2u*n + steps%2u) + 
+                                 other_parity_tiles*fill(mid, mid, 2u*n + 1u - steps%2u);
+
+        // tips of the diamond
+        reachable_num += fill(last, mid, n-1u) + fill(mid, 0, n-1u) + fill(0, mid, n-1u) + fill(mid, last, n-1u);
+
+        // small and large corner tiles along the four diagonal edges
+        const size_t small_steps{ n/2u - 1u };
+        const size_t large_steps{ 3u*n/2u - 1u };
+        for (const auto &corner : std::vector<Point<int>>{ {last,0},{last,last},{0,0},{0,last} })
+        {
+            reachable_num += (tiles_w+1u)*fill(corner.x, corner.y, small_steps);
+            reachable_num += tiles_w*fill(corner.x, corner.y, large_steps);
+        }
+
+        return reachable_num;
+    }
+
+    /*
+    Independent of the exact structure of the garden, the number of reachable plots for steps = r + k*P
+    (P = period of the tiling with constant parity, i.e. 2*N for odd N, r = steps%P) grows quadratically 
+    in k once the reachable area has left the start tile in all directions. Three brute force results for
+    small k determine the quadratic polynomial, which is then evaluated at the requested k.
+    */
+    uint64_t get_reachable_num_quadratic(const std::vector<std::string> &garden, size_t steps)
+    {
+        const size_t n{ std::max(garden.size(), garden.at(0).size()) };
+        const size_t period{ n%2u == 0u ? n : 2u*n };
+        const size_t k0{ 2u };
+        const size_t rem{ steps%period };
+        const int64_t f0 = static_cast<int64_t>(get_reachable_num_brute_force(garden, rem + k0*period));
+        const int64_t f1 = static_cast<int64_t>(get_reachable_num_brute_force(garden, rem + (k0+1u)*period));
+        const int64_t f2 = static_cast<int64_t>(get_reachable_num_brute_force(garden, rem + (k0+2u)*period));
+
+        const int64_t k = static_cast<int64_t>(steps/period) - static_cast<int64_t>(k0);
+        const int64_t d1 = f1 - f0;
+        const int64_t d2 = f2 - 2*f1 + f0;
+        return static_cast<uint64_t>(f0 + k*d1 + k*(k-1)/2*d2);
+    }
+
+    /**
+     * @brief Counts the reachable plots by running a BFS on enough copies of the garden to cover all steps
+     * Memory and runtime grow quadratically with steps, so this is only meant for small budgets
+     */
+    uint64_t get_reachable_num_brute_force(const std::vector<std::string> &garden, size_t steps)
+    {
+        Point<int> start{};
+        std::vector<std::string> tiled_garden = get_tiled_garden(garden, steps, start);
+        return get_reachable_num(get_reachable_counts(get_distance_map(tiled_garden, start)), steps);
+    }
+
+    /**
+     * @brief Simulates all steps one after another on the bit-parallel garden and returns the number of
+     * plots reachable after exactly steps. Unlike the BFS this yields the exact reachable set after each step
+     * 
+     * @param garden 2D map of garden plots and rocks
+     * @param start position (row, col) of the start plot
+     * @param steps number of steps
+     * @return uint64_t 
+     */
+    uint64_t get_reachable_num_stepwise(const std::vector<std::string> &garden, const Point<int> &start, size_t steps)
+    {
+        BitGarden bit_garden = get_bit_garden(garden, start);
+        // the reachable plots after each step are only written with trace level Verbose (e.g. to garden.txt)
+        const bool trace_steps{ trace_enabled(ETraceLevel::Verbose) };
+        if (trace_steps) print_garden(bit_garden, TraceSink::get().stream());
+        for (size_t i=0; i<steps; ++i)
+        {
+            do_single_step(bit_garden);
+            if (trace_steps)
+            {
+                print_garden(bit_garden, TraceSink::get().stream());
+                TraceSink::get().flush_if_full();
+            }
+        }
+        return count_reachable_plots(bit_garden);
+    }
+
+    BitGarden get_bit_garden(const std::vector<std::string> &garden, const Point<int> &start)
+    {
+        BitGarden bit_garden{ garden.size(), garden.at(0).size(), 0u, {}, {}, {} };
+        bit_garden.n_words = (bit_garden.n_col + WORD_BITS - 1u) / WORD_BITS;
+        const size_t n_total{ (bit_garden.n_row + 2u)*bit_garden.n_words };
+        bit_garden.plots.assign(n_total, 0u);
+        bit_garden.reachable.assign(n_total, 0u);
+        bit_garden.next_reachable.assign(n_total, 0u);
+
+        for (size_t row=0; row<bit_garden.n_row; ++row)
+        {
+            uint64_t *plot_row = &bit_garden.plots[(row+1u)*bit_garden.n_words];
+            for (size_t col=0; col<bit_garden.n_col; ++col)
             {
-                if (START_POS == garden.at(row).at(col))
+                if (ROCK != garden[row][col])
                 {
-                    empty_garden[row][col] = GARDEN_PLOT;
-                    cur_reach_pos[row][col] = REACHABLE;
+                    plot_row[col/WORD_BITS] |= uint64_t{ 1u } << (col%WORD_BITS);
                 }
             }
         }
-        std::ofstream out("garden.txt");
-        // repeatedly find the reachable positions after doing one step 
-        for (size_t i=0; i<steps; ++i)
+        const size_t s_row{ static_cast<size_t>(start.x) };
+        const size_t s_col{ static_cast<size_t>(start.y) };
+        bit_garden.reachable[(s_row+1u)*bit_garden.n_words + s_col/WORD_BITS] |= uint64_t{ 1u } << (s_col%WORD_BITS);
+
+        return bit_garden;
+    }
+
+    /*
+    A plot is reachable after the next step if any of its four neighbors is reachable now:
+    next = (left | right | up | down) & plots
+    Left and right neighbors are obtained by shifting each word by one bit and carrying the boundary bit over
+    from the adjacent word. Padding bits beyond the last column are never set in plots, so no extra masking
+    is needed. The loops work on plain contiguous arrays, which lets the compiler vectorize them (e.g. AVX2)
+    */
+    void do_single_step(BitGarden &bit_garden)
+    {
+        const size_t n_words{ bit_garden.n_words };
+        const uint64_t *cur = bit_garden.reachable.data();
+        const uint64_t *plots = bit_garden.plots.data();
+        uint64_t *nxt = bit_garden.next_reachable.data();
+
+        for (size_t row=1; row<=bit_garden.n_row; ++row)
         {
-            print_garden(cur_reach_pos,out);
-            out.flush();
-            cur_reach_pos = do_single_step(cur_reach_pos, empty_garden);
+            const uint64_t *up = cur + (row-1u)*n_words;
+            const uint64_t *mid = cur + row*n_words;
+            const uint64_t *down = cur + (row+1u)*n_words;
+            const uint64_t *plot_row = plots + row*n_words;
+            uint64_t *out = nxt + row*n_words;
+            for (size_t w=0; w<n_words; ++w)
+            {
+                const uint64_t carry_from_lower = (w > 0u) ? mid[w-1u] >> (WORD_BITS-1u) : 0u;
+                const uint64_t carry_from_upper = (w+1u < n_words) ? mid[w+1u] << (WORD_BITS-1u) : 0u;
+                const uint64_t from_left = (mid[w] << 1u) | carry_from_lower;
+                const uint64_t from_right = (mid[w] >> 1u) | carry_from_upper;
+                out[w] = (from_left | from_right | up[w] | down[w]) & plot_row[w];
+            }
         }
-        print_garden(cur_reach_pos,out);
-        out.close();
+        std::swap(bit_garden.reachable, bit_garden.next_reachable);
+    }
+
+    uint64_t count_reachable_plots(const BitGarden &bit_garden)
+    {
+        uint64_t reachable_num{ 0u };
+        for (const auto w : bit_garden.reachable)
+        {
+            reachable_num += std::bitset<WORD_BITS>(w).count();
+        }
+        return reachable_num;
+    }
+
+    /**
+     * @brief Creates enough copies of the garden around the original one, so that no path with at most 
+     * steps steps can leave the tiled garden
+     * 
+     * @param garden 2D map of garden plots and rocks
+     * @param steps maximum number of steps
+     * @param start is set to the start position inside the center tile
+     * @return std::vector<std::string> 
+     */
+    std::vector<std::string> get_tiled_garden(const std::vector<std::string> &garden, size_t steps, Point<int> &start)
+    {
+        const size_t n_row{ garden.size() };
+        const size_t n_col{ garden.at(0).size() };
+        const size_t tiles_row{ steps/n_row + 1u }; // copies needed above and below the start tile
+        const size_t tiles_col{ steps/n_col + 1u };
 
-        uint32_t reachable_pos_cnt{ 0ul };
-        for (int row=0; row<cur_reach_pos.size(); ++row)
+        std::vector<std::string> tiled_garden;
+        tiled_garden.reserve((2u*tiles_row + 1u)*n_row);
+        for (size_t t=0; t<2u*tiles_row + 1u; ++t)
         {
-            for (int col=0; col<cur_reach_pos.at(0).size(); ++col)
+            for (const auto &row : garden)
             {
-                if (REACHABLE == cur_reach_pos.at(row).at(col))
+                std::string tiled_row;
+                tiled_row.reserve((2u*tiles_col + 1u)*n_col);
+                for (size_t c=0; c<2u*tiles_col + 1u; ++c)
                 {
-                    ++reachable_pos_cnt;
+                    tiled_row += row;
                 }
+                tiled_garden.push_back(std::move(tiled_row));
+            }
+        }
+
+        start = get_start_pos(garden);
+        start.x += static_cast<int>(tiles_row*n_row);
+        start.y += static_cast<int>(tiles_col*n_col);
+        return tiled_garden;
+    }
+
+    bool is_diamond_decomposable(const std::vector<std::string> &garden, size_t steps)
+    {
+        const size_t n{ garden.size() };
+        if (n%2u == 0u || garden.at(0).size() != n || steps%n != n/2u || steps < n) return false;
+        if (garden[n/2u][n/2u] != START_POS) return false;
+
+        for (size_t i=0; i<n; ++i)
+        {
+            if (garden[n/2u][i] == ROCK || garden[i][n/2u] == ROCK || garden[0][i] == ROCK || 
+                garden[n-1u][i] == ROCK || garden[i][0] == ROCK || garden[i][n-1u] == ROCK)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Compares the tiled step counter with brute force (BFS and stepwise simulation) for all budgets
+     * up to max_steps, which the tiled counter does not answer by brute force itself
+     * 
+     * @throws std::runtime_error on the first mismatch
+     */
+    void cross_check_tiled(const std::vector<std::string> &garden, size_t max_steps)
+    {
+        for (size_t steps=garden.size(); steps<=max_steps; ++steps)
+        {
+            if (!is_diamond_decomposable(garden, steps)) continue;
+
+            auto tiled_num = get_reachable_num_diamond(garden, steps);
+            auto brute_force_num = get_reachable_num_brute_force(garden, steps);
+            Point<int> start{};
+            auto stepwise_num = get_reachable_num_stepwise(get_tiled_garden(garden, steps, start), start, steps);
+            if (tiled_num != brute_force_num || tiled_num != stepwise_num)
+            {
+                throw std::runtime_error("cross_check_tiled: Mismatch for " + std::to_string(steps) + " steps: " + 
+                    std::to_string(tiled_num) + " != " + std::to_string(brute_force_num) + " / " + std::to_string(stepwise_num));
             }
         }
-        return reachable_pos_cnt;
     }
 
     std::ostream& print_garden(const std::vector<std::string> &garden, std::ostream& out)
@@ -114,4 +469,22 @@ namespace Day21
         out << "\n";
         return out;
     }
-}
\ No newline at end of file
+
+    std::ostream& print_garden(const BitGarden &bit_garden, std::ostream& out)
+    {
+        for (size_t row=1; row<=bit_garden.n_row; ++row)
+        {
+            for (size_t col=0; col<bit_garden.n_col; ++col)
+            {
+                const size_t idx{ row*bit_garden.n_words + col/WORD_BITS };
+                const uint64_t mask{ uint64_t{ 1u } << (col%WORD_BITS) };
+                if (bit_garden.reachable[idx] & mask) out << REACHABLE;
+                else if (bit_garden.plots[idx] & mask) out << GARDEN_PLOT;
+                else out << ROCK;
+            }
+            out << "\n";
+        }
+        out << "\n";
+        return out;
+    }
+}
@@ -1,8 +1,7 @@
 #include <string>
 #include <set>
-#include <unordered_set>
-#include <unordered_map>
 #include <algorithm>
+#include <numeric>
 
 #include "../utility.h"
 
@@ -36,12 +35,20 @@ namespace Day22
         }
     };
 
-    bool do_overlap(const Brick &b1, const Brick &b2);
+    // Top view of all settled bricks: height of the highest cube and the brick it belongs to for each (x,y)
+    struct HeightMap
+    {
+        size_t n_x{};
+        size_t n_y{};
+        std::vector<TPos> height{};
+        std::vector<Brick*> top_brick{};
+    };
+
     int get_num_disintegratable_bricks(std::vector<Brick> &bricks);
     std::vector<Brick> get_bricks(const std::string &file_path);
-    Brick let_brick_fall(Brick &b, std::unordered_map<TPos,std::vector<Brick*>> &b_set);
-    void update_lower_collisions(Brick &b, const std::vector<Brick*> &b_map);
-    int get_num_falling_bricks(size_t idx, std::vector<Brick> &bricks);
+    HeightMap get_height_map(const std::vector<Brick> &bricks);
+    void let_brick_fall(Brick &b, HeightMap &height_map);
+    std::vector<int> get_chain_reaction_counts(const std::vector<Brick> &bricks);
 
     int sol_22_1(const std::string &file_path)
     {
@@ -55,111 +62,133 @@ namespace Day22
         auto bricks = get_bricks(file_path);
         get_num_disintegratable_bricks(bricks); // only interested in the tree creation (upper/lower neighbors)
 
-        int sum_affected_bricks{ 0 };
-        for (int i=0; i<bricks.size(); ++i)
-        {
-            sum_affected_bricks += get_num_falling_bricks(i,bricks);
-        }
-
-        return sum_affected_bricks;
+        auto chain_reaction_counts = get_chain_reaction_counts(bricks);
+        return std::accumulate(chain_reaction_counts.begin(), chain_reaction_counts.end(), 0);
     }
 
-    int get_num_falling_bricks(size_t idx, std::vector<Brick> &bricks)
+    /*
+    Idea: the support relation is a DAG rooted at the ground. Brick b falls after disintegrating brick d exactly if every
+    path from the ground to b passes through d, i.e. d dominates b. The immediate dominator of b is the lowest common
+    ancestor (in the dominator tree) of all its lower neighbors, or the ground if b rests on the ground.
+    The bricks are sorted bottom-up after settling, so all lower neighbors of a brick are processed before the brick
+    itself and the dominator tree can be built in a single pass, using binary lifting for the LCA queries.
+    The number of bricks falling when removing d is the size of its dominator subtree without d itself -> O(n log n)
+    */
+    std::vector<int> get_chain_reaction_counts(const std::vector<Brick> &bricks)
     {
-        auto &cur_brick = bricks[idx];
-
-        std::unordered_map<TPos,std::unordered_set<Brick*>> affected_bricks_map; // map key is the z-position
-        std::unordered_set<Brick*> affected_bricks;
-        TPos z{ cur_brick.start.z };
-        TPos z_end{ z+1 };
-        affected_bricks_map[z].insert(&cur_brick);
-
-        // iterate through all z coords and check each brick of affected_bricks_map on this level/z-coord
-        while (z < z_end)
+        // node 0 is the ground, brick i is node i+1
+        const size_t n_nodes{ bricks.size()+1u };
+        size_t n_levels{ 1u };
+        while ((size_t{ 1u } << n_levels) < n_nodes) ++n_levels;
+
+        std::vector<size_t> depth(n_nodes, 0u);
+        std::vector<size_t> ancestors(n_levels*n_nodes, 0u); // ancestors[k*n_nodes+v] is the 2^k-th dominator of v
+        auto lca = [&](size_t u, size_t v)
         {
-            for (auto &nxt_brick : affected_bricks_map[z])
+            if (depth[u] < depth[v]) std::swap(u,v);
+            for (size_t k=n_levels; k-- > 0u;)
             {
-                // check for each brick if it would fall
-                bool would_fall{ true };
-                for (auto &lower : nxt_brick->lower_neighbors)
-                {
-                    // check if any of the bricks below are static -> if so current brick is still be supported
-                    if (affected_bricks.find(lower) == affected_bricks.end()) 
-                    {
-                        would_fall = false;
-                        break;
-                    }
-                }
-
-                // special treatment for the first brick, which is disintegrated irrespective of its position or neighbors
-                if (affected_bricks.empty()) 
+                if (depth[u] >= depth[v] + (size_t{ 1u } << k)) u = ancestors[k*n_nodes+u];
+            }
+            if (u == v) return u;
+            for (size_t k=n_levels; k-- > 0u;)
+            {
+                if (ancestors[k*n_nodes+u] != ancestors[k*n_nodes+v])
                 {
-                    would_fall = true;
+                    u = ancestors[k*n_nodes+u];
+                    v = ancestors[k*n_nodes+v];
                 }
+            }
+            return ancestors[u];
+        };
 
-                if (would_fall)
-                {
-                    affected_bricks.insert(nxt_brick);
-                    for (auto &parent : nxt_brick->upper_neighbors)
-                    {
-                        affected_bricks_map[parent->start.z].insert(parent);
-                        z_end = z_end > parent->start.z ? z_end : parent->start.z+1;
-                    }
-                }
+        for (size_t i=0; i<bricks.size(); ++i)
+        {
+            const size_t node{ i+1u };
+            size_t idom{ 0u };
+            bool is_first{ true };
+            for (const auto &lower : bricks[i].lower_neighbors)
+            {
+                const size_t lower_node{ static_cast<size_t>(lower - bricks.data()) + 1u };
+                idom = is_first ? lower_node : lca(idom, lower_node);
+                is_first = false;
+            }
 
+            depth[node] = depth[idom]+1u;
+            ancestors[node] = idom;
+            for (size_t k=1; k<n_levels; ++k)
+            {
+                ancestors[k*n_nodes+node] = ancestors[(k-1u)*n_nodes + ancestors[(k-1u)*n_nodes+node]];
             }
-            ++z;
         }
 
-        return affected_bricks.size()-1; // subtract 1, for starting brick should not be counted
-    }
+        // dominators always precede the bricks they dominate -> accumulate subtree sizes in reverse order
+        std::vector<int> subtree_size(n_nodes, 1);
+        for (size_t node=n_nodes-1u; node>0u; --node)
+        {
+            subtree_size[ancestors[node]] += subtree_size[node];
+        }
 
-    bool do_overlap(const Brick &b1, const Brick &b2)
-    {
-        if (b1.end.x < b2.start.x || b2.end.x < b1.start.x) return false;
-        if (b1.end.y < b2.start.y || b2.end.y < b1.start.y) return false;
-        if (b1.end.z < b2.start.z || b2.end.z < b1.start.z) return false;
-        return true;
+        std::vector<int> chain_reaction_counts(bricks.size());
+        for (size_t i=0; i<bricks.size(); ++i)
+        {
+            chain_reaction_counts[i] = subtree_size[i+1u]-1;
+        }
+        return chain_reaction_counts;
     }
 
-    void update_lower_collisions(Brick &b, const std::vector<Brick*> &candidate_bricks)
+    HeightMap get_height_map(const std::vector<Brick> &bricks)
     {
-        for (auto &b2 : candidate_bricks)
+        HeightMap height_map{};
+        for (const auto &b : bricks)
         {
-            if (do_overlap(b,*b2)) 
-            {
-                // if b and b2 do collide, they must be immediate neighbors -> update lower and upper neighbor
-                b.lower_neighbors.push_back(b2); 
-                b2->upper_neighbors.push_back(&b);
-            }
+            height_map.n_x = std::max(height_map.n_x, static_cast<size_t>(std::max(b.start.x,b.end.x))+1u);
+            height_map.n_y = std::max(height_map.n_y, static_cast<size_t>(std::max(b.start.y,b.end.y))+1u);
         }
+        height_map.height.assign(height_map.n_x*height_map.n_y, 0);
+        height_map.top_brick.assign(height_map.n_x*height_map.n_y, nullptr);
+        return height_map;
     }
 
-    Brick let_brick_fall(Brick &b, std::unordered_map<TPos,std::vector<Brick*>> &b_map)
+    /*
+    All bricks below b have already settled, so b drops directly onto the highest cube within its (x,y) footprint.
+    Every brick whose top cube lies at exactly this height inside the footprint supports b.
+    Afterwards the footprint of the height map is raised to the top of b -> O(footprint) per brick
+    */
+    void let_brick_fall(Brick &b, HeightMap &height_map)
     {
-        std::vector<Brick*> candidates{ }; 
+        auto get_idx = [&height_map](TPos x, TPos y) { return static_cast<size_t>(y)*height_map.n_x + static_cast<size_t>(x); };
 
-        while (b.start.z > 0)
+        TPos max_height{ 0 };
+        for (TPos y=b.start.y; y<=b.end.y; ++y)
         {
-            update_lower_collisions(b,candidates);
-            if (b.lower_neighbors.size() > 0)
+            for (TPos x=b.start.x; x<=b.end.x; ++x)
             {
-                break;
+                max_height = std::max(max_height, height_map.height[get_idx(x,y)]);
             }
-            // let brick fall one z-coord further
-            --b.start.z;
-            --b.end.z;   
-            auto it = b_map.find(b.start.z);
-            if (it != b_map.end()) 
+        }
+
+        const TPos brick_height{ b.end.z - b.start.z };
+        b.start.z = max_height + 1;
+        b.end.z = b.start.z + brick_height;
+
+        for (TPos y=b.start.y; y<=b.end.y; ++y)
+        {
+            for (TPos x=b.start.x; x<=b.end.x; ++x)
             {
-                candidates = it->second;
+                const size_t idx{ get_idx(x,y) };
+                Brick *lower{ height_map.top_brick[idx] };
+                // a brick may touch b with several cubes -> only register it once
+                if (max_height > 0 && height_map.height[idx] == max_height &&
+                    std::find(b.lower_neighbors.begin(), b.lower_neighbors.end(), lower) == b.lower_neighbors.end())
+                {
+                    b.lower_neighbors.push_back(lower);
+                    lower->upper_neighbors.push_back(&b);
+                }
+                height_map.height[idx] = b.end.z;
+                height_map.top_brick[idx] = &b;
             }
         }
-        // after while loop we eiher have a z-coord of 0 or a collision -> increase z by 1
-        ++b.start.z;
-        ++b.end.z;
-
-        return b;
     }
 
     int get_num_disintegratable_bricks(std::vector<Brick> &bricks)
@@ -167,14 +196,12 @@ namespace Day22
         // 1. process bricks from the bottom to top
         // sort bricks vector so bricks starting at smaller z-coords can be processed first
         std::sort(bricks.begin(), bricks.end(), ZStartComp());
-        // create a map of bricks for fast access for collision check (bricks are mapped based on z-endcoord)
-        std::unordered_map<TPos,std::vector<Brick*>> z_pos_brick_map;
+        // height map of all settled bricks, so each brick can be dropped directly to its final position
+        HeightMap height_map = get_height_map(bricks);
 
         for (auto &b : bricks)
         {
-            let_brick_fall(b,z_pos_brick_map);
-            // insert processed brick in unordered_map
-            z_pos_brick_map[b.end.z].push_back(&b);
+            let_brick_fall(b,height_map);
         }
 
         // now all upper and lower contact points have been set and we can check each brick
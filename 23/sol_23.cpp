@@ -1,10 +1,17 @@
 #include <string>
 #include <stack>
 #include <unordered_map>
-#include <unordered_set>
+#include <stdexcept>
 #include <set>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <bitset>
+#include <functional>
 
 #include "../utility.h"
+#include "../csr_graph.h"
 
 namespace Day23
 {
@@ -12,6 +19,8 @@ namespace Day23
     using TPos = int;
     using TVId = int;
     using TEdge = std::pair<int,TVId>;
+    using TVisited = std::uint64_t; // bit i is set if vertex i is part of the current path
+    using TGraph = CsrGraph<int,TVId>;
 
     constexpr char PATH{ '.' };
     constexpr char FOREST{ '#' };
@@ -19,6 +28,19 @@ namespace Day23
     constexpr char RIGHT_SLOPE{ '>' };
     constexpr char LEFT_SLOPE{ '<' };
     constexpr char DOWN_SLOPE{ 'v' };
+    constexpr size_t MAX_VERTICES{ 64u }; // visited vertices are tracked in a TVisited bitmask, so at most 64 junctions incl. start and end
+    constexpr size_t MAX_DEGREE{ 4u }; // a tile has at most 4 neighbors
+    constexpr size_t SPLIT_DEPTH{ 8u }; // depth of the search tree at which the work is distributed over threads
+    constexpr int NO_PATH{ -1 };
+
+    // Search strategy for the longest path, selected by the program option --strategy
+    enum class EStrategy
+    {
+        Dfs,    // plain exhaustive DFS
+        Bnb,    // parallel branch-and-bound
+        Memo,   // memoized DP over (vertex, reachable unvisited vertices)
+        Bench   // run and time all strategies, the timings are traced at ETraceLevel::Info
+    };
 
     struct EqualComp
     {
@@ -28,10 +50,22 @@ namespace Day23
         }
     };
 
-    struct State
+    // Reduced graph in CSR format plus precomputed per-vertex data for the searches, vertex ids are in [0, n_vertices)
+    struct CompactGraph
+    {
+        size_t n_vertices{};
+        TVId end_id{};
+        TVId pre_end_id{ -1 }; // only vertex with an edge to end (-1 if there are several)
+        TGraph graph{};
+        std::vector<TVisited> neighbor_mask{}; // bitmask of all vertices reachable by a single edge
+        std::vector<int> max_in_len{}; // length of the longest edge ending in a vertex
+    };
+
+    // Partial path of the branch-and-bound search
+    struct SearchState
     {
         TVId pos{};
-        std::unordered_set<TVId> path{};
+        TVisited visited{};
         int path_len{};
     };
 
@@ -64,6 +98,24 @@ namespace Day23
     std::vector<Point<TPos>> get_neighbors_2(const std::vector<std::string> &trail_map, const Point<TPos> &pos);
     std::pair<Point<TPos>,Point<TPos>> get_start_end_pos(const std::vector<std::string> &trail_map);
     GraphStruct reduce_to_graph(const std::vector<std::string> &trail_map, const Point<TPos> &start,const Point<TPos> &end, bool part_1=true);
+    CompactGraph get_compact_graph(const GraphStruct &graph_struct, const Point<TPos> &end);
+    CompactGraph get_compact_graph(TGraph graph, TVId end_id);
+    int get_longest_path_dfs(const CompactGraph &g, TVId pos, TVisited visited, int path_len);
+    int get_longest_path_parallel(const CompactGraph &g, size_t n_threads);
+    void collect_split_states(const CompactGraph &g, const SearchState &state, size_t depth, std::vector<SearchState> &split_states, std::atomic<int> &best);
+    void branch_and_bound(const CompactGraph &g, const SearchState &state, std::atomic<int> &best);
+    int get_upper_bound(const CompactGraph &g, const SearchState &state);
+    void update_best(std::atomic<int> &best, int path_len);
+    int count_trailing_zeros(TVisited mask);
+    TVisited get_reachable_mask(const CompactGraph &g, TVId pos, TVisited visited);
+    int get_longest_path_memo(const CompactGraph &g);
+    int get_remaining_path_memo(const CompactGraph &g, TVId pos, TVisited visited, std::vector<std::unordered_map<TVisited,int>> &memo);
+    CompactGraph orient_perimeter_edges(const CompactGraph &g);
+    bool is_perimeter_grid(const CompactGraph &g);
+    std::vector<TVisited> get_grid_template(size_t n_rows, size_t n_cols, bool cut_corners);
+    bool does_match_template(const std::vector<TVisited> &nbs, TVId end_id, const std::vector<TVisited> &grid);
+    int run_strategy(const CompactGraph &g, EStrategy strategy);
+    EStrategy get_strategy();
 
     int sol_23_1(const std::string &file_path)
     {
@@ -86,45 +138,486 @@ namespace Day23
 
     int get_longest_path(const std::vector<std::string> &trail_map, const Point<TPos> &start,const Point<TPos> &end, bool part_1)
     {
-        std::stack<State> state_stack;
-        int max_path_len{ 0 };
-
         GraphStruct graph_struct = reduce_to_graph(trail_map, start,end, part_1);
-        auto &g = graph_struct.g;
-        auto end_id = graph_struct.vertex_map[end];
+        CompactGraph g = get_compact_graph(graph_struct, end);
 
-        State start_state{ 0, {0}, 0 };
-        state_stack.push(start_state);
+        EStrategy strategy = get_strategy();
+        if (EStrategy::Bench == strategy)
+        {
+            int path_len{ NO_PATH };
+            const std::vector<std::pair<std::string,EStrategy>> strategies{ {"dfs",EStrategy::Dfs}, {"bnb",EStrategy::Bnb}, {"memo",EStrategy::Memo} };
+            for (const auto &s : strategies)
+            {
+                auto res = funcTime<int>(run_strategy, g, s.second);
+                TRACE(ETraceLevel::Info, "Day23: strategy " << s.first << ": " << res.second << " in " << res.first << " ns\n");
+                path_len = res.second;
+            }
+            return path_len;
+        }
+        return run_strategy(g, strategy);
+    }
+
+    int run_strategy(const CompactGraph &g, EStrategy strategy)
+    {
+        switch (strategy)
+        {
+        case EStrategy::Dfs:
+            // start vertex always has id 0
+            return get_longest_path_dfs(g, 0, TVisited{ 1u }, 0);
+        case EStrategy::Memo:
+            return get_longest_path_memo(g);
+        default:
+            return get_longest_path_parallel(g, std::max(1u, std::thread::hardware_concurrency()));
+        }
+    }
 
-        while(!state_stack.empty())
+    EStrategy get_strategy()
+    {
+        const std::string strategy = get_program_option("strategy", "bnb");
+        if ("dfs" == strategy) return EStrategy::Dfs;
+        if ("bnb" == strategy) return EStrategy::Bnb;
+        if ("memo" == strategy) return EStrategy::Memo;
+        if ("bench" == strategy) return EStrategy::Bench;
+        throw std::invalid_argument("Day23: Unknown strategy '" + strategy + "', expected dfs, bnb, memo or bench");
+    }
+
+    /**
+     * @brief Copies the reduced graph into a CSR graph, so that the searches iterate the neighbors of a
+     * vertex in contiguous memory without any hash map lookups or allocations
+     * 
+     * @throws std::runtime_error if the graph has more vertices than fit into TVisited
+     */
+    CompactGraph get_compact_graph(const GraphStruct &graph_struct, const Point<TPos> &end)
+    {
+        const size_t n_vertices{ graph_struct.vertex_map.size() };
+        if (n_vertices > MAX_VERTICES)
         {
-            auto nxt_state = state_stack.top();
-            state_stack.pop();
+            throw std::runtime_error("get_compact_graph: Graph has " + std::to_string(n_vertices) + " vertices, only " + 
+                std::to_string(MAX_VERTICES) + " are supported");
+        }
 
-            // check end condition otherwise add neighbors
-            if (nxt_state.pos == end_id)
+        std::vector<TGraph::InputEdge> edges;
+        for (TVId src=0; src<static_cast<TVId>(n_vertices); ++src)
+        {
+            auto v_edges = graph_struct.g.find(src);
+            if (v_edges == graph_struct.g.end()) continue;
+            for (const auto &e : v_edges->second)
             {
-                max_path_len = max_path_len < nxt_state.path_len ? nxt_state.path_len : max_path_len;
+                edges.push_back({ src, e.second, e.first });
             }
-            else
+        }
+        return get_compact_graph(TGraph(n_vertices, edges), graph_struct.vertex_map.at(end));
+    }
+
+    CompactGraph get_compact_graph(TGraph graph, TVId end_id)
+    {
+        CompactGraph g{};
+        g.n_vertices = graph.num_vertices();
+        g.end_id = end_id;
+        g.graph = std::move(graph);
+        g.neighbor_mask.assign(g.n_vertices, 0u);
+        g.max_in_len.assign(g.n_vertices, 0);
+
+        for (TVId src=0; src<static_cast<TVId>(g.n_vertices); ++src)
+        {
+            for (const auto &e : g.graph.neighbors(src))
             {
-                std::set<TEdge> neighbors = g[nxt_state.pos];
-                for (const auto &neigh : neighbors)
+                g.neighbor_mask[static_cast<size_t>(src)] |= TVisited{ 1u } << e.dst;
+                g.max_in_len[static_cast<size_t>(e.dst)] = std::max(g.max_in_len[static_cast<size_t>(e.dst)], e.len);
+                if (e.dst == g.end_id && src != g.end_id)
                 {
-                    auto new_state = nxt_state;
-                    if (new_state.path.insert(neigh.second).second)
-                    {
-                        new_state.pos = neigh.second;
-                        new_state.path_len += neigh.first;
-                        state_stack.push(new_state);
-                    }
+                    g.pre_end_id = (g.pre_end_id == -1) ? src : -2;
                 }
             }
         }
+        if (g.pre_end_id < 0) g.pre_end_id = -1;
+        return g;
+    }
 
+    /*
+    Exhaustive DFS over all simple paths from pos to the end vertex. The current path is only represented
+    by a bitmask of visited vertices and its length, so trying a neighbor does not copy anything.
+    If the end vertex can only be reached through a single vertex, a path has to go to end as soon as it 
+    reaches this vertex, every other continuation would cut off the end.
+    Returns the length of the longest path from pos to end, or -1 if end is not reachable
+    */
+    int get_longest_path_dfs(const CompactGraph &g, TVId pos, TVisited visited, int path_len)
+    {
+        if (pos == g.end_id) return path_len;
+
+        int max_path_len{ -1 };
+        for (const auto &e : g.graph.neighbors(pos))
+        {
+            const TVisited nxt_bit{ TVisited{ 1u } << e.dst };
+            if (visited & nxt_bit) continue;
+            if (pos == g.pre_end_id && e.dst != g.end_id) continue;
+
+            int len = get_longest_path_dfs(g, e.dst, visited | nxt_bit, path_len + e.len);
+            if (len > max_path_len) max_path_len = len;
+        }
         return max_path_len;
     }
 
+    /*
+    Branch-and-bound version of the exhaustive search:
+    - All partial paths with SPLIT_DEPTH edges are collected first and then distributed over n_threads,
+      which search their subtrees independently
+    - The longest path found so far is shared by all threads and used to prune every partial path
+      whose upper bound (see get_upper_bound) cannot beat it anymore
+    */
+    int get_longest_path_parallel(const CompactGraph &g, size_t n_threads)
+    {
+        std::atomic<int> best{ -1 };
+        std::vector<SearchState> split_states;
+        collect_split_states(g, { 0, TVisited{ 1u }, 0 }, SPLIT_DEPTH, split_states, best);
+        // searching promising (long) prefixes first gives a good bound early on
+        std::sort(split_states.begin(), split_states.end(), [](const SearchState &s1, const SearchState &s2){
+            return s1.path_len > s2.path_len;
+        });
+
+        std::atomic<size_t> nxt_idx{ 0u };
+        auto worker = [&]()
+        {
+            for (size_t i=nxt_idx++; i<split_states.size(); i=nxt_idx++)
+            {
+                branch_and_bound(g, split_states[i], best);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t=1; t<n_threads; ++t)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+
+        return best.load();
+    }
+
+    /**
+     * @brief Collects all partial paths with depth edges starting at state. Paths that reach the end vertex
+     * before are directly used to update best
+     */
+    void collect_split_states(const CompactGraph &g, const SearchState &state, size_t depth, std::vector<SearchState> &split_states, std::atomic<int> &best)
+    {
+        if (state.pos == g.end_id)
+        {
+            update_best(best, state.path_len);
+            return;
+        }
+        if (depth == 0u)
+        {
+            split_states.push_back(state);
+            return;
+        }
+
+        for (const auto &e : g.graph.neighbors(state.pos))
+        {
+            const TVisited nxt_bit{ TVisited{ 1u } << e.dst };
+            if (state.visited & nxt_bit) continue;
+            if (state.pos == g.pre_end_id && e.dst != g.end_id) continue;
+
+            collect_split_states(g, { e.dst, state.visited | nxt_bit, state.path_len + e.len }, depth-1u, split_states, best);
+        }
+    }
+
+    void branch_and_bound(const CompactGraph &g, const SearchState &state, std::atomic<int> &best)
+    {
+        if (state.pos == g.end_id)
+        {
+            update_best(best, state.path_len);
+            return;
+        }
+        if (get_upper_bound(g, state) <= best.load(std::memory_order_relaxed)) return;
+
+        for (const auto &e : g.graph.neighbors(state.pos))
+        {
+            const TVisited nxt_bit{ TVisited{ 1u } << e.dst };
+            if (state.visited & nxt_bit) continue;
+            if (state.pos == g.pre_end_id && e.dst != g.end_id) continue;
+
+            branch_and_bound(g, { e.dst, state.visited | nxt_bit, state.path_len + e.len }, best);
+        }
+    }
+
+    /*
+    Every vertex that is still added to the path is entered by exactly one edge, so the remaining path
+    cannot be longer than the sum of the longest incoming edge of each unvisited vertex that is still 
+    reachable from the current position. The reachable vertices are found by a flood fill on bitmasks.
+    Returns -1 if the end vertex is not reachable anymore
+    */
+    int get_upper_bound(const CompactGraph &g, const SearchState &state)
+    {
+        const TVisited pos_bit{ TVisited{ 1u } << state.pos };
+        const TVisited reachable = get_reachable_mask(g, state.pos, state.visited);
+        if (!(reachable & (TVisited{ 1u } << g.end_id))) return NO_PATH;
+
+        int bound{ state.path_len };
+        for (TVisited r=reachable & ~pos_bit; r; r&=r-1u)
+        {
+            bound += g.max_in_len[static_cast<size_t>(count_trailing_zeros(r))];
+        }
+        return bound;
+    }
+
+    /**
+     * @brief Flood fill on bitmasks: returns all vertices reachable from pos (including pos) without
+     * passing a visited vertex
+     */
+    TVisited get_reachable_mask(const CompactGraph &g, TVId pos, TVisited visited)
+    {
+        const TVisited pos_bit{ TVisited{ 1u } << pos };
+        TVisited reachable{ pos_bit };
+        TVisited frontier{ pos_bit };
+        while (frontier)
+        {
+            TVisited nxt_frontier{ 0u };
+            for (TVisited f=frontier; f; f&=f-1u)
+            {
+                nxt_frontier |= g.neighbor_mask[static_cast<size_t>(count_trailing_zeros(f))];
+            }
+            frontier = nxt_frontier & ~visited & ~reachable;
+            reachable |= frontier;
+        }
+        return reachable;
+    }
+
+    /*
+    The longest remaining path from pos only depends on pos and on the unvisited vertices that are still
+    reachable from pos. All other vertices are cut off and can be ignored, so this reduced set is used
+    as memo key, which lets different prefixes share their results.
+    If the junctions form a grid like in the puzzle (see is_perimeter_grid), the edges on the outer ring are
+    additionally made one-way (see orient_perimeter_edges), which removes all paths that walk the ring backwards
+    and get stuck. Any other graph is searched as it is.
+    */
+    int get_longest_path_memo(const CompactGraph &g)
+    {
+        CompactGraph oriented_g = is_perimeter_grid(g) ? orient_perimeter_edges(g) : g;
+        std::vector<std::unordered_map<TVisited,int>> memo(oriented_g.n_vertices);
+        // start vertex always has id 0
+        return get_remaining_path_memo(oriented_g, 0, TVisited{ 1u }, memo);
+    }
+
+    int get_remaining_path_memo(const CompactGraph &g, TVId pos, TVisited visited, std::vector<std::unordered_map<TVisited,int>> &memo)
+    {
+        if (pos == g.end_id) return 0;
+
+        const TVisited reachable = get_reachable_mask(g, pos, visited);
+        if (!(reachable & (TVisited{ 1u } << g.end_id))) return NO_PATH;
+        auto &pos_memo = memo[static_cast<size_t>(pos)];
+        auto it = pos_memo.find(reachable);
+        if (it != pos_memo.end()) return it->second;
+
+        int max_remaining{ NO_PATH };
+        for (const auto &e : g.graph.neighbors(pos))
+        {
+            const TVisited nxt_bit{ TVisited{ 1u } << e.dst };
+            if (visited & nxt_bit) continue;
+            if (pos == g.pre_end_id && e.dst != g.end_id) continue;
+
+            int remaining = get_remaining_path_memo(g, e.dst, visited | nxt_bit, memo);
+            if (remaining != NO_PATH && remaining + e.len > max_remaining)
+            {
+                max_remaining = remaining + e.len;
+            }
+        }
+        pos_memo.emplace(reachable, max_remaining);
+        return max_remaining;
+    }
+
+    /*
+    In the junction grid every inner vertex has 4 edges, while the vertices on the outer ring have at most 3.
+    A path that uses a ring edge towards the start (i.e. to a vertex with a smaller hop distance from start)
+    can never reach the end again, because the ring together with the visited part separates it from the end.
+    Therefore only the ring edges pointing away from start are kept.
+    */
+    CompactGraph orient_perimeter_edges(const CompactGraph &g)
+    {
+        // hop distance of each vertex from start (BFS)
+        std::vector<int> hops(g.n_vertices, -1);
+        std::vector<TVId> queue{ 0 };
+        hops[0] = 0;
+        for (size_t q=0; q<queue.size(); ++q)
+        {
+            const TVId v{ queue[q] };
+            for (const auto &e : g.graph.neighbors(v))
+            {
+                if (hops[static_cast<size_t>(e.dst)] == -1)
+                {
+                    hops[static_cast<size_t>(e.dst)] = hops[static_cast<size_t>(v)] + 1;
+                    queue.push_back(e.dst);
+                }
+            }
+        }
+
+        std::vector<TGraph::InputEdge> edges;
+        for (TVId v=0; v<static_cast<TVId>(g.n_vertices); ++v)
+        {
+            for (const auto &e : g.graph.neighbors(v))
+            {
+                const bool is_ring_edge{ g.graph.degree(v) < MAX_DEGREE && g.graph.degree(e.dst) < MAX_DEGREE };
+                if (is_ring_edge && hops[static_cast<size_t>(e.dst)] < hops[static_cast<size_t>(v)]) continue;
+
+                edges.push_back({ v, e.dst, e.len });
+            }
+        }
+        return get_compact_graph(TGraph(g.n_vertices, edges), g.end_id);
+    }
+
+    /*
+    Checks that orient_perimeter_edges is valid for g, i.e. g has the shape of the puzzle's junction graph:
+    an r x c grid (r,c >= 3) of junctions with start and end attached to two opposite corners by a single edge
+    each. In the puzzle the two other corners are cut off and their neighbors are connected directly, both
+    variants are accepted. Apart from the edge into start, which the reduced graph does not contain, the graph 
+    has to be undirected (part 2), so part 1 graphs are never oriented.
+    Each possible template is built and matched against g (see does_match_template).
+    */
+    bool is_perimeter_grid(const CompactGraph &g)
+    {
+        const size_t n{ g.n_vertices };
+        std::vector<TVisited> nbs{ g.neighbor_mask };
+        size_t n_edges{ 0u };
+        for (TVId v=0; v<static_cast<TVId>(n); ++v)
+        {
+            for (const auto &e : g.graph.neighbors(v))
+            {
+                if (v == 0) nbs[static_cast<size_t>(e.dst)] |= TVisited{ 1u };
+                else if (!(g.neighbor_mask[static_cast<size_t>(e.dst)] & (TVisited{ 1u } << v))) return false;
+            }
+        }
+        for (const auto &mask : nbs) n_edges += std::bitset<64>(mask).count();
+
+        for (size_t n_rows=3; n_rows*3u<=n; ++n_rows)
+        {
+            for (size_t n_cols=3; n_rows*n_cols<=n; ++n_cols)
+            {
+                for (bool cut_corners : { false, true })
+                {
+                    std::vector<TVisited> grid = get_grid_template(n_rows, n_cols, cut_corners);
+                    size_t n_grid_edges{ 0u };
+                    for (const auto &mask : grid) n_grid_edges += std::bitset<64>(mask).count();
+                    if (grid.size() == n && n_grid_edges == n_edges && does_match_template(nbs, g.end_id, grid)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Returns the neighbor masks of the puzzle's junction graph with n_rows x n_cols junctions.
+     * Start has id 0 and is attached to junction (0,0), end has the last id and is attached to (n_rows-1,n_cols-1).
+     */
+    std::vector<TVisited> get_grid_template(size_t n_rows, size_t n_cols, bool cut_corners)
+    {
+        auto is_cut = [&](size_t i, size_t j) {
+            return cut_corners && ((i == 0u && j+1u == n_cols) || (i+1u == n_rows && j == 0u));
+        };
+        const size_t n_vertices{ n_rows*n_cols - (cut_corners ? 2u : 0u) + 2u }; // incl. start and end
+        if (n_vertices > MAX_VERTICES) return {};
+
+        std::vector<TVisited> grid(n_vertices, 0u);
+        std::vector<size_t> ids(n_rows*n_cols, 0u);
+        size_t nxt_id{ 1u };
+        for (size_t cell=0; cell<ids.size(); ++cell)
+        {
+            if (!is_cut(cell/n_cols, cell%n_cols)) ids[cell] = nxt_id++;
+        }
+        auto add_edge = [&grid](size_t v, size_t w) {
+            grid[v] |= TVisited{ 1u } << w;
+            grid[w] |= TVisited{ 1u } << v;
+        };
+        add_edge(0u, ids[0]);
+        add_edge(n_vertices-1u, ids.back());
+        for (size_t i=0; i<n_rows; ++i)
+        {
+            for (size_t j=0; j<n_cols; ++j)
+            {
+                if (is_cut(i,j)) continue;
+                if (j+1u < n_cols && !is_cut(i,j+1u)) add_edge(ids[i*n_cols+j], ids[i*n_cols+j+1u]);
+                if (i+1u < n_rows && !is_cut(i+1u,j)) add_edge(ids[i*n_cols+j], ids[(i+1u)*n_cols+j]);
+            }
+        }
+        if (cut_corners)
+        {
+            add_edge(ids[n_cols-2u], ids[n_cols+n_cols-1u]);
+            add_edge(ids[(n_rows-2u)*n_cols], ids[(n_rows-1u)*n_cols+1u]);
+        }
+        return grid;
+    }
+
+    /*
+    Backtracking search for an isomorphism from the template to the graph (both given as neighbor masks),
+    which maps start to start
+    and end to end. The template vertices are mapped in BFS order, so each one is mapped to an unused neighbor
+    of the image of its BFS parent, which has the same degree and the same edges to all vertices mapped so far.
+    The junction degree is at most 4, so there is hardly any branching.
+    */
+    bool does_match_template(const std::vector<TVisited> &nbs, TVId end_id, const std::vector<TVisited> &grid)
+    {
+        const size_t n{ grid.size() };
+        const size_t grid_end{ n-1u };
+        std::vector<size_t> order{ 0u };
+        std::vector<size_t> parent(n, 0u);
+        TVisited seen{ 1u };
+        for (size_t q=0; q<order.size(); ++q)
+        {
+            for (TVisited grid_nbs=grid[order[q]] & ~seen; grid_nbs; grid_nbs&=grid_nbs-1u)
+            {
+                const size_t w{ static_cast<size_t>(count_trailing_zeros(grid_nbs)) };
+                parent[w] = order[q];
+                order.push_back(w);
+            }
+            seen |= grid[order[q]];
+        }
+        if (order.size() != n) return false;
+
+        std::vector<TVId> image(n, -1);
+        image[0] = 0;
+        std::function<bool(size_t,TVisited,TVisited)> match = [&](size_t k, TVisited mapped, TVisited used)
+        {
+            if (k == n) return true;
+            const size_t t{ order[k] };
+            // image of the template edges between t and all mapped vertices
+            TVisited expected_nbs{ 0u };
+            for (TVisited grid_nbs=grid[t] & mapped; grid_nbs; grid_nbs&=grid_nbs-1u)
+            {
+                expected_nbs |= TVisited{ 1u } << image[static_cast<size_t>(count_trailing_zeros(grid_nbs))];
+            }
+            TVisited candidates{ nbs[static_cast<size_t>(image[parent[t]])] & ~used };
+            candidates &= (t == grid_end) ? (TVisited{ 1u } << end_id) : ~(TVisited{ 1u } << end_id);
+            for (; candidates; candidates&=candidates-1u)
+            {
+                const TVId h{ count_trailing_zeros(candidates) };
+                const TVisited h_nbs{ nbs[static_cast<size_t>(h)] };
+                if (std::bitset<64>(h_nbs).count() != std::bitset<64>(grid[t]).count() || (h_nbs & used) != expected_nbs) continue;
+                image[t] = h;
+                if (match(k+1u, mapped | (TVisited{ 1u } << t), used | (TVisited{ 1u } << h))) return true;
+            }
+            return false;
+        };
+        return match(1u, TVisited{ 1u }, TVisited{ 1u });
+    }
+
+    void update_best(std::atomic<int> &best, int path_len)
+    {
+        int cur_best = best.load();
+        while (path_len > cur_best && !best.compare_exchange_weak(cur_best, path_len)) { ; }
+    }
+
+    int count_trailing_zeros(TVisited mask)
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(mask);
+    #else
+        int cnt{ 0 };
+        for (; !(mask & 1u); mask >>= 1) ++cnt;
+        return cnt;
+    #endif
+    }
+
     /*
     Since input data implies there are not many paths that lead to destination, we can reduce all tiles that only have 2 path neighbors 
     After this we get a much smaller graph with 36 nodes that only show the connection points where paths split 
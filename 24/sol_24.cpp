@@ -2,6 +2,10 @@
 #include <array>
 #include <map>
 #include <limits>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <thread>
 
 #include "../utility.h"
 
@@ -11,10 +15,12 @@ namespace Day24
     using TVel = int64_t;
     using HailPos = Point3D<TPos>;
     using HailVel = Point3D<TVel>;
+    __extension__ typedef __int128 TWide; // products of positions and velocity determinants exceed 64 bits
 
-    constexpr TPos INF{ std::numeric_limits<TPos>::max() };
-    constexpr double TOLERANCE{ 1e0 };
-    constexpr HailPos NO_INTERSECTION{ INF,INF,INF };
+    constexpr double CLIP_MARGIN{ 1e3 }; // widens the clipping box, so rounding can never drop a real crossing
+    constexpr size_t MIN_PATHS_PER_THREAD{ 1024u }; // fewer paths are not worth starting threads for
+    constexpr size_t N_UNKNOWNS{ 6u }; // position and velocity of the rock
+    constexpr std::uint64_t PRIME{ (std::uint64_t{ 1u } << 61) - 1u };
     constexpr TPos LOWER_LIMIT{ 200000000000000 };
     constexpr TPos UPPER_LIMIT{ 400000000000000 };
     // constexpr TPos LOWER_LIMIT{ 7 };
@@ -25,73 +31,481 @@ namespace Day24
         HailPos p{};
         HailVel v{};
     };
+
+    // Bounding box of the part of a hailstone's xy-path, which lies within the test area
+    struct ClippedPath
+    {
+        HailState s{}; // copy of the hailstone, so the pairwise tests only read contiguous memory
+        double x_min{};
+        double x_max{};
+        double y_min{};
+        double y_max{};
+    };
+
+    // Exact position along the boundary of the test area: side (0..3) and the coordinate num/den along it
+    struct BoundaryPoint
+    {
+        int side{};
+        TWide num{};
+        TWide den{ 1 };
+    };
+
+    // Part of a path, which starts outside the test area, between entering and leaving it
+    struct BoundaryChord
+    {
+        BoundaryPoint enter{};
+        BoundaryPoint exit{};
+    };
+
+    // Augmented matrix [A | b] of the linear equations for the rock throw
+    using TEquationSystem = std::array<std::array<TWide,N_UNKNOWNS+1u>,N_UNKNOWNS>;
     
-    HailPos calc_point_of_intersection(const HailState &s1, const HailState &s2);
+    TPos count_crossings_in_area(const std::vector<HailState> &state_vec, TPos lower, TPos upper, size_t n_threads);
+    bool get_clipped_path(const HailState &s, TPos lower, TPos upper, ClippedPath &path);
+    TPos count_interleaved_chords(const std::vector<BoundaryChord> &chords, const std::vector<size_t> &chord_paths, std::vector<bool> &is_exact);
+    bool get_boundary_chord(const HailState &s, TPos lower, TPos upper, BoundaryChord &chord);
+    BoundaryPoint get_boundary_point(TWide x_num, TWide y_num, TWide den, TPos lower, TPos upper);
+    bool is_before(const BoundaryPoint &p_1, const BoundaryPoint &p_2);
+    bool do_paths_cross_in_area(const HailState &s1, const HailState &s2, TPos lower, TPos upper);
+    HailState get_rock_throw(const std::vector<HailState> &state_vec);
+    TEquationSystem get_rock_equations(const HailState &s0, const HailState &s1, const HailState &s2);
+    bool solve_modulo_prime(TEquationSystem equations, std::array<TWide,N_UNKNOWNS> &solution);
+    bool does_hit_all(const HailState &rock, const std::vector<HailState> &state_vec);
     std::vector<HailState> get_hail_states(const std::string &file_path);
     HailState parse_str_to_hail(const std::string &hail_str);
 
-    int sol_24_1(const std::string &file_path)
+    TPos sol_24_1(const std::string &file_path)
     {
         std::vector<HailState> state_vec = get_hail_states(file_path);
-        int intersection_cnt{ 0 };
-        
-        for (size_t i=0; i<state_vec.size(); ++i)
+
+        return count_crossings_in_area(state_vec, LOWER_LIMIT, UPPER_LIMIT, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+
+    TPos sol_24_2(const std::string &file_path)
+    {
+        std::vector<HailState> state_vec = get_hail_states(file_path);
+        HailState rock = get_rock_throw(state_vec);
+
+        return rock.p.x + rock.p.y + rock.p.z;
+    }
+
+    /*
+    Idea: only the part of each path within the test area can produce a counted crossing.
+    - Each path (t >= 0) is clipped to the test area, paths that never enter it are dropped
+    - A path, which starts outside the area, crosses it along a chord between two points on the boundary.
+      Two such chords intersect within the area exactly if their end points interleave along the boundary,
+      so all chord pairs are counted at once in O(n log n) (see count_interleaved_chords)
+    - Paths starting inside the area, touching it in a single point, running along its boundary or sharing a
+      boundary point with another chord form the exact set. Each pair with at least one of them is decided
+      exactly (see do_paths_cross_in_area), but only if the clipped bounding boxes of both paths overlap:
+      the paths are sorted by their smallest x and each path is only compared to the following ones until they
+      start behind it. A chord path skips directly to the following exact paths. The positions are independent,
+      so threads take them one after the other from a shared counter
+    The total cost is O(n log n + n_exact*n), paths starting inside the area are still compared pairwise.
+    Clipping uses doubles, but the widened area only lets through more candidates, it never drops one.
+    */
+    TPos count_crossings_in_area(const std::vector<HailState> &state_vec, TPos lower, TPos upper, size_t n_threads)
+    {
+        std::vector<ClippedPath> paths;
+        std::vector<BoundaryChord> chords;
+        std::vector<size_t> chord_paths; // index of the path of each chord
+        paths.reserve(state_vec.size());
+        for (const auto &state : state_vec)
         {
-            for (size_t j=i+1; j<state_vec.size(); ++j)
+            ClippedPath path{};
+            if (!get_clipped_path(state, lower, upper, path)) continue;
+            path.s = state;
+            BoundaryChord chord{};
+            if (get_boundary_chord(state, lower, upper, chord))
             {
-                auto int_point = calc_point_of_intersection(state_vec[i],state_vec[j]);
-                std::cout << int_point.x << ", " << int_point.y << std::endl;
-                if (NO_INTERSECTION != int_point && int_point.x <= UPPER_LIMIT && 
-                    int_point.y <= UPPER_LIMIT && int_point.x >= LOWER_LIMIT && int_point.y >= LOWER_LIMIT)
+                chords.push_back(chord);
+                chord_paths.push_back(paths.size());
+            }
+            paths.push_back(path);
+        }
+
+        std::vector<bool> is_exact(paths.size(), true);
+        for (size_t path_idx : chord_paths) is_exact[path_idx] = false;
+        TPos crossing_cnt{ count_interleaved_chords(chords, chord_paths, is_exact) };
+
+        std::vector<size_t> order(paths.size());
+        std::iota(order.begin(), order.end(), size_t{ 0u });
+        std::sort(order.begin(), order.end(), [&paths](size_t i, size_t j){ return paths[i].x_min < paths[j].x_min; });
+        std::vector<ClippedPath> sorted_paths;
+        std::vector<size_t> exact_positions; // positions of the exact paths in sorted_paths
+        sorted_paths.reserve(paths.size());
+        for (size_t i : order)
+        {
+            if (is_exact[i]) exact_positions.push_back(sorted_paths.size());
+            sorted_paths.push_back(paths[i]);
+        }
+
+        n_threads = std::max(size_t{ 1u }, std::min(n_threads, exact_positions.size()/MIN_PATHS_PER_THREAD));
+        std::vector<TPos> thread_cnts(n_threads, 0);
+        std::atomic<size_t> nxt_idx{ 0u };
+        auto worker = [&](size_t t)
+        {
+            TPos thread_cnt{ 0 };
+            auto add_if_crossing = [&](const ClippedPath &path_i, const ClippedPath &path_j)
+            {
+                if (path_j.y_min > path_i.y_max || path_i.y_min > path_j.y_max) return;
+                thread_cnt += do_paths_cross_in_area(path_i.s, path_j.s, lower, upper);
+            };
+            for (size_t i=nxt_idx++; i<sorted_paths.size(); i=nxt_idx++)
+            {
+                const ClippedPath &path_i = sorted_paths[i];
+                if (is_exact[order[i]])
                 {
-                    ++intersection_cnt;
+                    for (size_t j=i+1; j<sorted_paths.size() && sorted_paths[j].x_min <= path_i.x_max; ++j)
+                    {
+                        add_if_crossing(path_i, sorted_paths[j]);
+                    }
+                    continue;
+                }
+                auto e = std::upper_bound(exact_positions.begin(), exact_positions.end(), i);
+                for (; e != exact_positions.end() && sorted_paths[*e].x_min <= path_i.x_max; ++e)
+                {
+                    add_if_crossing(path_i, sorted_paths[*e]);
                 }
             }
+            thread_cnts[t] = thread_cnt;
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t t=1; t<n_threads; ++t)
+        {
+            threads.emplace_back(worker, t);
+        }
+        worker(0u);
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+
+        for (const auto &thread_cnt : thread_cnts)
+        {
+            crossing_cnt += thread_cnt;
+        }
+        TRACE(ETraceLevel::Info, "Day24: " << paths.size() << " of " << state_vec.size() << " paths enter the test area, "
+            << exact_positions.size() << " of them are tested pairwise\n");
+
+        return crossing_cnt;
+    }
+
+    /*
+    Sorts all chord end points along the boundary and counts the pairs of chords, whose end points interleave:
+    chords are processed by increasing first end point and a Fenwick tree over the boundary ranks holds the second
+    end points of all processed chords. Each processed chord i with a_i < a_j < b_i < b_j crosses chord j.
+    Chords sharing an end point with another chord (e.g. crossing on the boundary or lying on the same line)
+    are excluded and marked in is_exact, so they are tested pairwise instead.
+    */
+    TPos count_interleaved_chords(const std::vector<BoundaryChord> &chords, const std::vector<size_t> &chord_paths, std::vector<bool> &is_exact)
+    {
+        std::vector<std::pair<BoundaryPoint,size_t>> end_points; // end point and its chord
+        end_points.reserve(2u*chords.size());
+        for (size_t c=0; c<chords.size(); ++c)
+        {
+            end_points.push_back({ chords[c].enter, c });
+            end_points.push_back({ chords[c].exit, c });
+        }
+        std::sort(end_points.begin(), end_points.end(), [](const auto &e1, const auto &e2){
+            return is_before(e1.first, e2.first);
+        });
+        std::vector<bool> is_tied(chords.size(), false);
+        for (size_t e=1; e<end_points.size(); ++e)
+        {
+            if (is_before(end_points[e-1u].first, end_points[e].first)) continue;
+            is_tied[end_points[e-1u].second] = true;
+            is_tied[end_points[e].second] = true;
+        }
+
+        // rank of the first and second end point of each remaining chord, end_points is already ordered by rank
+        std::vector<std::pair<size_t,size_t>> ranks(chords.size(), { 0u, 0u });
+        std::vector<bool> has_first(chords.size(), false);
+        size_t n_ranks{ 0u };
+        for (const auto &end_point : end_points)
+        {
+            const size_t c{ end_point.second };
+            if (is_tied[c]) continue;
+            if (has_first[c]) ranks[c].second = ++n_ranks;
+            else ranks[c].first = ++n_ranks;
+            has_first[c] = true;
+        }
+
+        std::vector<size_t> order;
+        for (size_t c=0; c<chords.size(); ++c)
+        {
+            if (is_tied[c]) is_exact[chord_paths[c]] = true;
+            else order.push_back(c);
         }
-        return intersection_cnt;
+        std::sort(order.begin(), order.end(), [&ranks](size_t c1, size_t c2){ return ranks[c1].first < ranks[c2].first; });
+
+        std::vector<TPos> fenwick(n_ranks+1u, 0);
+        auto get_prefix_cnt = [&fenwick](size_t rank) {
+            TPos cnt{ 0 };
+            for (; rank>0u; rank&=rank-1u) cnt += fenwick[rank];
+            return cnt;
+        };
+        TPos crossing_cnt{ 0 };
+        for (size_t c : order)
+        {
+            crossing_cnt += get_prefix_cnt(ranks[c].second-1u) - get_prefix_cnt(ranks[c].first);
+            for (size_t rank=ranks[c].second; rank<=n_ranks; rank+=rank&(~rank+1u)) ++fenwick[rank];
+        }
+        return crossing_cnt;
     }
 
+    /*
+    Computes the chord of a path, which starts outside the test area, exactly: the area is entered at the largest
+    and left at the smallest of the per axis entering and leaving times. Times are fractions num/den with den = |v|
+    of the axis they belong to, so the end points are fractions with the same denominator.
+    Returns false if the path starts inside the area, does not cross it or runs along its boundary.
+    */
+    bool get_boundary_chord(const HailState &s, TPos lower, TPos upper, BoundaryChord &chord)
+    {
+        auto is_inside = [lower, upper](TPos pos) { return pos >= lower && pos <= upper; };
+        auto is_on_boundary = [lower, upper](TPos pos, TVel vel) { return vel == 0 && (pos == lower || pos == upper); };
+        if (is_inside(s.p.x) && is_inside(s.p.y)) return false;
+        if ((s.v.x == 0 && !is_inside(s.p.x)) || (s.v.y == 0 && !is_inside(s.p.y))) return false;
+        if (is_on_boundary(s.p.x, s.v.x) || is_on_boundary(s.p.y, s.v.y)) return false;
 
-    int sol_24_2(const std::string &file_path)
+        // (num, den) of the entering and leaving time
+        std::pair<TWide,TWide> t_enter{ 0, 1 };
+        std::pair<TWide,TWide> t_exit{ 1, 0 }; // infinity
+        auto is_earlier = [](const std::pair<TWide,TWide> &t_1, const std::pair<TWide,TWide> &t_2) {
+            return t_1.first*t_2.second < t_2.first*t_1.second;
+        };
+        for (const auto &axis : { std::make_pair(s.p.x, s.v.x), std::make_pair(s.p.y, s.v.y) })
+        {
+            if (axis.second == 0) continue;
+            const TWide den{ axis.second < 0 ? -TWide{ axis.second } : TWide{ axis.second } };
+            std::pair<TWide,TWide> t_1{ (TWide{ lower } - axis.first)*(axis.second < 0 ? -1 : 1), den };
+            std::pair<TWide,TWide> t_2{ (TWide{ upper } - axis.first)*(axis.second < 0 ? -1 : 1), den };
+            if (is_earlier(t_2, t_1)) std::swap(t_1, t_2);
+            if (is_earlier(t_enter, t_1)) t_enter = t_1;
+            if (is_earlier(t_2, t_exit)) t_exit = t_2;
+        }
+        if (!is_earlier(t_enter, t_exit)) return false;
+
+        auto get_point_at = [&](const std::pair<TWide,TWide> &t) {
+            return get_boundary_point(TWide{ s.p.x }*t.second + t.first*s.v.x, TWide{ s.p.y }*t.second + t.first*s.v.y,
+                t.second, lower, upper);
+        };
+        chord.enter = get_point_at(t_enter);
+        chord.exit = get_point_at(t_exit);
+        return true;
+    }
+
+    /**
+     * @brief Returns the position of the boundary point (x_num/den, y_num/den) along the boundary.
+     * The sides are numbered counter-clockwise starting with y = lower, each side contains its first corner.
+     */
+    BoundaryPoint get_boundary_point(TWide x_num, TWide y_num, TWide den, TPos lower, TPos upper)
     {
+        const TWide scaled_lower{ TWide{ lower }*den };
+        const TWide scaled_upper{ TWide{ upper }*den };
+        if (y_num == scaled_lower && x_num < scaled_upper) return { 0, x_num, den };
+        if (x_num == scaled_upper && y_num < scaled_upper) return { 1, y_num, den };
+        if (y_num == scaled_upper && x_num > scaled_lower) return { 2, -x_num, den };
+        return { 3, -y_num, den };
+    }
 
-        return 0;
+    bool is_before(const BoundaryPoint &p_1, const BoundaryPoint &p_2)
+    {
+        if (p_1.side != p_2.side) return p_1.side < p_2.side;
+        return p_1.num*p_2.den < p_2.num*p_1.den;
+    }
+
+    /**
+     * @brief Clips the xy-path p + t*v with t >= 0 to the (widened) test area, returns false if it never enters
+     */
+    bool get_clipped_path(const HailState &s, TPos lower, TPos upper, ClippedPath &path)
+    {
+        const double lo{ static_cast<double>(lower) - CLIP_MARGIN };
+        const double hi{ static_cast<double>(upper) + CLIP_MARGIN };
+        double t_enter{ 0. };
+        double t_exit{ std::numeric_limits<double>::infinity() };
+
+        auto clip_axis = [&](TPos pos, TVel vel)
+        {
+            const double p{ static_cast<double>(pos) };
+            if (vel == 0) return p >= lo && p <= hi;
+            double t_1{ (lo - p) / static_cast<double>(vel) };
+            double t_2{ (hi - p) / static_cast<double>(vel) };
+            if (t_1 > t_2) std::swap(t_1, t_2);
+            t_enter = std::max(t_enter, t_1);
+            t_exit = std::min(t_exit, t_2);
+            return t_enter <= t_exit;
+        };
+        if (!clip_axis(s.p.x, s.v.x) || !clip_axis(s.p.y, s.v.y)) return false;
+
+        const double x_1{ static_cast<double>(s.p.x) + t_enter*static_cast<double>(s.v.x) };
+        const double x_2{ static_cast<double>(s.p.x) + t_exit*static_cast<double>(s.v.x) };
+        const double y_1{ static_cast<double>(s.p.y) + t_enter*static_cast<double>(s.v.y) };
+        const double y_2{ static_cast<double>(s.p.y) + t_exit*static_cast<double>(s.v.y) };
+        path.x_min = std::min(x_1, x_2) - CLIP_MARGIN;
+        path.x_max = std::max(x_1, x_2) + CLIP_MARGIN;
+        path.y_min = std::min(y_1, y_2) - CLIP_MARGIN;
+        path.y_max = std::max(y_1, y_2) + CLIP_MARGIN;
+        return true;
     }
 
     /*
-    p_1 + t_1*v_1 = p_2 + t_2*v_2 can be re-arranged to p_1-p_2=At which provides a solution 
-    if determinant is != 0
-    A = [v_2 -v_1] and t = [t_2; t_1]
+    p_1 + t_1*v_1 = p_2 + t_2*v_2 can be re-arranged to p_2-p_1 = A*t with A = [v_1 -v_2] and t = [t_1; t_2],
+    which has a unique solution if det(A) != 0. With Cramer's rule t_i = num_i/det, so all checks are done on
+    the numerators scaled by det instead of on rounded times and coordinates:
+    - both times >= 0 <=> num_1, num_2 >= 0 (after making det positive)
+    - lower <= p_1 + t_1*v_1 <= upper <=> lower*det <= p_1*det + num_1*v_1 <= upper*det
+    Positions take up to 49 bits and determinants 21 bits, so all products fit into 128 bits.
     */
-    HailPos calc_point_of_intersection(const HailState &s1, const HailState &s2)
+    bool do_paths_cross_in_area(const HailState &s1, const HailState &s2, TPos lower, TPos upper)
     {
-        auto det = -s2.v.x*s1.v.y + s2.v.y*s1.v.x;
+        TWide det{ TWide{ s2.v.x }*s1.v.y - TWide{ s2.v.y }*s1.v.x };
         if (det == 0)
         {
             // hails fly on parallel trajectories and do not intersect
-            return NO_INTERSECTION;
+            return false;
         }
-        else
+
+        const TWide p_diff_x{ TWide{ s2.p.x } - s1.p.x };
+        const TWide p_diff_y{ TWide{ s2.p.y } - s1.p.y };
+        TWide num_1{ p_diff_y*s2.v.x - p_diff_x*s2.v.y };
+        TWide num_2{ p_diff_y*s1.v.x - p_diff_x*s1.v.y };
+        if (det < 0)
         {
-            auto inv_det = 1. / det;
-            auto p_diff_x = s1.p.x - s2.p.x;
-            auto p_diff_y = s1.p.y - s2.p.y;
-            auto t_1 = inv_det * (-p_diff_x*s2.v.y + p_diff_y*s2.v.x);
-            auto t_2 = inv_det * (-p_diff_x*s1.v.y + p_diff_y*s1.v.x);
+            det = -det;
+            num_1 = -num_1;
+            num_2 = -num_2;
+        }
+        const TWide scaled_x{ TWide{ s1.p.x }*det + num_1*s1.v.x };
+        const TWide scaled_y{ TWide{ s1.p.y }*det + num_1*s1.v.y };
+        const TWide scaled_lower{ TWide{ lower }*det };
+        const TWide scaled_upper{ TWide{ upper }*det };
+        // most candidate pairs do cross, so all conditions are combined without branches
+        return (num_1 >= 0) & (num_2 >= 0) & (scaled_x >= scaled_lower) & (scaled_x <= scaled_upper) &
+            (scaled_y >= scaled_lower) & (scaled_y <= scaled_upper);
+    }
 
-            if (t_1 < 0 || t_2 < 0) return NO_INTERSECTION;
 
-            auto diff_x = (s1.p.x + t_1*s1.v.x) - (s2.p.x + t_2*s2.v.x);
-            auto diff_y = (s1.p.y + t_1*s1.v.y) - (s2.p.y + t_2*s2.v.y);
-            // if (std::abs(diff_x) > TOLERANCE || std::abs(diff_y) > TOLERANCE)
-            // {
-            //     throw std::runtime_error("calc_point_of_intersection: Failed to calc intersection points: Diffs:\n" + std::to_string(diff_x) + " - " + std::to_string(diff_y));
-            // }
+    /**
+     * @brief Finds the rock throw, which hits every hailstone: three hailstones determine it, further triples
+     * are only tried if the first one is degenerate
+     */
+    HailState get_rock_throw(const std::vector<HailState> &state_vec)
+    {
+        for (size_t j=1; j+1<state_vec.size(); ++j)
+        {
+            std::array<TWide,N_UNKNOWNS> solution{};
+            TEquationSystem equations = get_rock_equations(state_vec[0], state_vec[j], state_vec[j+1]);
+            if (!solve_modulo_prime(equations, solution)) continue;
 
-            return { s1.v * t_1 + s1.p };
+            HailState rock{ { static_cast<TPos>(solution[0]), static_cast<TPos>(solution[1]), static_cast<TPos>(solution[2]) },
+                { static_cast<TVel>(solution[3]), static_cast<TVel>(solution[4]), static_cast<TVel>(solution[5]) } };
+            if (does_hit_all(rock, state_vec)) return rock;
         }
+        throw std::runtime_error("get_rock_throw: No rock throw hits all " + std::to_string(state_vec.size()) + " hailstones");
     }
 
+    /*
+    The rock (p,v) hits hailstone i, if p + t*v = p_i + t*v_i for some t, i.e. (p - p_i) x (v - v_i) = 0.
+    Expanded, every hailstone contributes the same non-linear term p x v, which cancels out in the difference
+    of two hailstones i and j:
+        p x (v_j - v_i) + (p_j - p_i) x v = p_j x v_j - p_i x v_i
+    The pairs (s0,s1) and (s0,s2) yield 6 linear equations for the 6 unknowns (p_x,p_y,p_z,v_x,v_y,v_z).
+    */
+    TEquationSystem get_rock_equations(const HailState &s0, const HailState &s1, const HailState &s2)
+    {
+        TEquationSystem equations{};
+        size_t row{ 0u };
+        for (const HailState *s : { &s1, &s2 })
+        {
+            const TWide dx{ TWide{ s->v.x } - s0.v.x }, dy{ TWide{ s->v.y } - s0.v.y }, dz{ TWide{ s->v.z } - s0.v.z };
+            const TWide ex{ TWide{ s->p.x } - s0.p.x }, ey{ TWide{ s->p.y } - s0.p.y }, ez{ TWide{ s->p.z } - s0.p.z };
+            const TWide cx{ TWide{ s->p.y }*s->v.z - TWide{ s->p.z }*s->v.y - (TWide{ s0.p.y }*s0.v.z - TWide{ s0.p.z }*s0.v.y) };
+            const TWide cy{ TWide{ s->p.z }*s->v.x - TWide{ s->p.x }*s->v.z - (TWide{ s0.p.z }*s0.v.x - TWide{ s0.p.x }*s0.v.z) };
+            const TWide cz{ TWide{ s->p.x }*s->v.y - TWide{ s->p.y }*s->v.x - (TWide{ s0.p.x }*s0.v.y - TWide{ s0.p.y }*s0.v.x) };
+            //                     p_x  p_y  p_z  v_x  v_y  v_z  rhs
+            equations[row++] = { {   0,  dz, -dy,   0, -ez,  ey,  cx } };
+            equations[row++] = { { -dz,   0,  dx,  ez,   0, -ex,  cy } };
+            equations[row++] = { {  dy, -dx,   0, -ey,  ex,   0,  cz } };
+        }
+        return equations;
+    }
+
+    /*
+    Exact Gaussian elimination of rationals would need numbers of up to ~190 bits (minors of the system),
+    so the system is solved modulo the prime 2^61-1 instead, where every step is exact and fits into 128 bits.
+    The rock coordinates are integers with |x| < PRIME/2, so the symmetric residue is the integer solution.
+    Returns false if the system is singular (modulo the prime).
+    */
+    bool solve_modulo_prime(TEquationSystem equations, std::array<TWide,N_UNKNOWNS> &solution)
+    {
+        __extension__ typedef unsigned __int128 TMod;
+        auto to_mod = [](TWide val) { val %= TWide{ PRIME }; return static_cast<TMod>(val < 0 ? val + TWide{ PRIME } : val); };
+        auto mul_mod = [](TMod a, TMod b) { return (a*b) % PRIME; };
+        auto inv_mod = [&mul_mod](TMod a)
+        {
+            // Fermat's little theorem: a^(PRIME-2) = a^-1
+            TMod inv{ 1u };
+            for (std::uint64_t e=PRIME-2u; e>0u; e>>=1u, a=mul_mod(a,a))
+            {
+                if (e & 1u) inv = mul_mod(inv, a);
+            }
+            return inv;
+        };
+
+        std::array<std::array<TMod,N_UNKNOWNS+1u>,N_UNKNOWNS> m{};
+        for (size_t r=0; r<N_UNKNOWNS; ++r)
+        {
+            for (size_t c=0; c<=N_UNKNOWNS; ++c) m[r][c] = to_mod(equations[r][c]);
+        }
+
+        for (size_t col=0; col<N_UNKNOWNS; ++col)
+        {
+            size_t pivot{ col };
+            while (pivot < N_UNKNOWNS && m[pivot][col] == 0u) ++pivot;
+            if (pivot == N_UNKNOWNS) return false;
+            std::swap(m[col], m[pivot]);
+
+            const TMod inv{ inv_mod(m[col][col]) };
+            for (auto &val : m[col]) val = mul_mod(val, inv);
+            for (size_t r=0; r<N_UNKNOWNS; ++r)
+            {
+                if (r == col || m[r][col] == 0u) continue;
+                const TMod factor{ m[r][col] };
+                for (size_t c=col; c<=N_UNKNOWNS; ++c)
+                {
+                    m[r][c] = (m[r][c] + PRIME - mul_mod(factor, m[col][c])) % PRIME;
+                }
+            }
+        }
+
+        for (size_t r=0; r<N_UNKNOWNS; ++r)
+        {
+            const TWide val{ static_cast<TWide>(m[r][N_UNKNOWNS]) };
+            solution[r] = (val > TWide{ PRIME/2u }) ? val - TWide{ PRIME } : val;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checks exactly that the rock meets each hailstone at the same position at a time t >= 0:
+     * (p - p_i) x (v - v_i) = 0 and (p_i - p) * (v - v_i) >= 0. 
+     * If v = v_i, both conditions hold for any position, but the rock only hits the hailstone if p = p_i.
+     */
+    bool does_hit_all(const HailState &rock, const std::vector<HailState> &state_vec)
+    {
+        for (const auto &s : state_vec)
+        {
+            const TWide px{ TWide{ rock.p.x } - s.p.x }, py{ TWide{ rock.p.y } - s.p.y }, pz{ TWide{ rock.p.z } - s.p.z };
+            const TWide vx{ TWide{ rock.v.x } - s.v.x }, vy{ TWide{ rock.v.y } - s.v.y }, vz{ TWide{ rock.v.z } - s.v.z };
+            if (py*vz != pz*vy || pz*vx != px*vz || px*vy != py*vx) return false;
+            if (px*vx + py*vy + pz*vz > 0) return false;
+            if (vx == 0 && vy == 0 && vz == 0 && (px != 0 || py != 0 || pz != 0)) return false;
+        }
+        return true;
+    }
 
     HailState parse_str_to_hail(const std::string &hail_str)
     {
@@ -1,13 +1,18 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <array>
 #include <algorithm>
 #include <limits>
+#include <random>
+#include <thread>
 
 #include "../utility.h"
 
 using PlantNum = std::uint64_t;
 
+constexpr size_t MIN_RANGES_PER_THREAD{ 4096u }; // smaller seed lists are not worth starting threads for
+
 struct PlantRange
 {
     PlantNum start_val;
@@ -21,15 +26,44 @@ public:
     using DstNum = PlantNum;
     using Range = PlantNum;
 
-    PlantNum get_mapped_num(PlantNum src_num) const;
-    std::vector<PlantRange> get_mapped_ranges(PlantRange src_range) const;
-
-
-    std::map<SrcNum,std::pair<DstNum,Range>> src_range_map;
+    // mapping ranges as sorted struct of arrays: [src_starts[i], src_starts[i]+ranges[i]) -> dst_starts[i] + ...
+    std::vector<SrcNum> src_starts{};
+    std::vector<DstNum> dst_starts{};
+    std::vector<Range> ranges{};
     std::string src_type_name;
     std::string dst_type_name;
 };
 
+/**
+ * \class PiecewiseLinearMap
+ * \brief Map of plant numbers consisting of consecutive segments, which are shifted by a constant offset each.
+ *
+ * Segment i covers [breakpoints[i], breakpoints[i+1]) and maps each value v to v+offsets[i] (modulo 2^64, so
+ * negative offsets are stored as their two's complement). The last segment contains domain_end and is the identity.
+ * Values >= domain_end are neither source nor destination of any mapping, so the whole chain of planting maps
+ * can be composed into a single PiecewiseLinearMap.
+ */
+class PiecewiseLinearMap
+{
+public:
+    PiecewiseLinearMap(const PlantingMap &planting_map, PlantNum end_num);
+
+    PiecewiseLinearMap compose(const PiecewiseLinearMap &next_map) const;
+    PlantNum get_mapped_num(PlantNum src_num) const;
+    void map_many(std::vector<PlantNum> &src_nums) const;
+    PlantNum get_min_mapped_num(PlantRange src_range) const;
+    size_t get_segment_num() const { return breakpoints.size(); }
+
+private:
+    PiecewiseLinearMap(PlantNum end_num) : domain_end{ end_num } {};
+    size_t get_segment_idx(PlantNum src_num) const;
+    void add_segment(PlantNum start, PlantNum offset);
+
+    PlantNum domain_end;
+    std::vector<PlantNum> breakpoints{}; // start of each segment, breakpoints[0] is 0
+    std::vector<PlantNum> offsets{};
+};
+
 struct InputDataDay5_1
 {
     std::map<std::string,PlantingMap> planting_maps;
@@ -46,6 +80,10 @@ InputDataDay5_1 get_planting_maps(const std::string &file_path);
 InputDataDay5_2 get_planting_maps_2(const std::string &file_path);
 std::vector<PlantNum> get_seed_locations(const InputDataDay5_1 &input_data);
 PlantNum get_lowest_seed_location(const InputDataDay5_2 &input_data);
+PiecewiseLinearMap get_seed_to_location_map(const std::map<std::string,PlantingMap> &planting_maps);
+PlantNum get_min_location(const PiecewiseLinearMap &seed_to_location, const std::vector<PlantRange> &seed_ranges, size_t n_threads);
+InputDataDay5_2 get_synthetic_almanac(size_t n_seed_ranges, size_t n_mappings, std::uint64_t seed);
+void benchmark_lowest_seed_location();
 
 PlantNum sol_5_1(const std::string &file_path)
 {
@@ -58,6 +96,8 @@ PlantNum sol_5_1(const std::string &file_path)
 
 int sol_5_2(const std::string &file_path)
 {
+    if ("1" == get_program_option("bench_5", "0")) benchmark_lowest_seed_location();
+
     InputDataDay5_2 data_in = get_planting_maps_2(file_path);
 
     return get_lowest_seed_location(data_in);
@@ -65,149 +105,288 @@ int sol_5_2(const std::string &file_path)
 
 PlantNum get_lowest_seed_location(const InputDataDay5_2 &input_data)
 {
-    PlantNum min_location{ std::numeric_limits<PlantNum>::max() };
-    auto &seed_ranges_vec = input_data.seed_ranges;
-    auto &plant_mappings = input_data.planting_maps;
+    PiecewiseLinearMap seed_to_location = get_seed_to_location_map(input_data.planting_maps);
 
+    return get_min_location(seed_to_location, input_data.seed_ranges, std::max(1u, std::thread::hardware_concurrency()));
+}
 
-    for (auto seed_range : seed_ranges_vec)
+/*
+Idea: the seed ranges are independent of each other, so they are split into one contiguous chunk per thread.
+Each thread only reads the shared composed map and writes its minimum into its own cache line sized slot,
+the minimum of all slots is taken after joining the threads.
+*/
+PlantNum get_min_location(const PiecewiseLinearMap &seed_to_location, const std::vector<PlantRange> &seed_ranges, size_t n_threads)
+{
+    struct alignas(64) ThreadMin
     {
-        std::string cur_name = "seed";
-        std::vector<PlantRange> mapped_ranges{ seed_range };
-        while (cur_name != "location")
-        {
-            auto &cur_mapping = plant_mappings.at(cur_name);
-            auto nxt_target_type_name = cur_mapping.dst_type_name;
-            std::vector<PlantRange> new_mapped_ranges;
-            for (auto &range : mapped_ranges)
-            {
-                std::vector<PlantRange> tmp_ranges = cur_mapping.get_mapped_ranges(range);
-                new_mapped_ranges.insert(new_mapped_ranges.begin(), tmp_ranges.begin(), tmp_ranges.end());
-            }
+        PlantNum val{ std::numeric_limits<PlantNum>::max() };
+    };
 
-            cur_name = nxt_target_type_name;
-            mapped_ranges = new_mapped_ranges;
-        }
-        for (auto new_range : mapped_ranges)
+    n_threads = std::max(size_t{ 1u }, std::min(n_threads, seed_ranges.size()/MIN_RANGES_PER_THREAD));
+    std::vector<ThreadMin> thread_mins(n_threads);
+    auto worker = [&](size_t t)
+    {
+        const size_t first{ seed_ranges.size()*t/n_threads };
+        const size_t last{ seed_ranges.size()*(t+1u)/n_threads };
+        PlantNum min_location{ std::numeric_limits<PlantNum>::max() };
+        for (size_t i=first; i<last; ++i)
         {
-            if (new_range.start_val < min_location) min_location = new_range.start_val;
-
+            min_location = std::min(min_location, seed_to_location.get_min_mapped_num(seed_ranges[i]));
         }
+        thread_mins[t].val = min_location;
+    };
 
+    std::vector<std::thread> threads;
+    for (size_t t=1; t<n_threads; ++t)
+    {
+        threads.emplace_back(worker, t);
+    }
+    worker(0u);
+    for (auto &t : threads)
+    {
+        t.join();
     }
 
+    PlantNum min_location{ std::numeric_limits<PlantNum>::max() };
+    for (const auto &thread_min : thread_mins)
+    {
+        min_location = std::min(min_location, thread_min.val);
+    }
     return min_location;
+}
+
+/**
+ * @brief Creates a random almanac with n_mappings non-overlapping ranges per stage within [0,2^32)
+ * and n_seed_ranges random seed ranges
+ */
+InputDataDay5_2 get_synthetic_almanac(size_t n_seed_ranges, size_t n_mappings, std::uint64_t seed)
+{
+    constexpr PlantNum MAX_NUM{ PlantNum{ 1u } << 32 };
+    const std::vector<std::string> type_names{ "seed", "soil", "fertilizer", "water", "light", "temperature", "humidity", "location" };
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<PlantNum> num_dist(0u, MAX_NUM-1u);
 
+    InputDataDay5_2 input_data;
+    for (size_t stage=0; stage+1<type_names.size(); ++stage)
+    {
+        PlantingMap plant_map;
+        plant_map.src_type_name = type_names[stage];
+        plant_map.dst_type_name = type_names[stage+1];
+
+        // 2*n_mappings sorted cut points, every second gap is a mapping range
+        std::vector<PlantNum> cuts(2u*n_mappings);
+        for (auto &cut : cuts) cut = num_dist(rng);
+        std::sort(cuts.begin(), cuts.end());
+        for (size_t i=0; i<n_mappings; ++i)
+        {
+            const PlantNum range{ cuts[2u*i+1u] - cuts[2u*i] };
+            if (range == 0u) continue;
+            plant_map.src_starts.push_back(cuts[2u*i]);
+            plant_map.dst_starts.push_back(num_dist(rng) % (MAX_NUM-range));
+            plant_map.ranges.push_back(range);
+        }
+        input_data.planting_maps[plant_map.src_type_name] = plant_map;
+    }
 
+    std::uniform_int_distribution<PlantNum> len_dist(1u, 1u << 20);
+    for (size_t i=0; i<n_seed_ranges; ++i)
+    {
+        const PlantNum start{ num_dist(rng) };
+        input_data.seed_ranges.push_back({ start, start + len_dist(rng) - 1u });
+    }
+
+    return input_data;
 }
 
-std::vector<PlantRange> PlantingMap::get_mapped_ranges(PlantRange src_range) const
+/**
+ * @brief Times the lowest location search on a synthetic almanac for increasing thread counts
+ * (enabled by the program option --bench_5=1)
+ */
+void benchmark_lowest_seed_location()
 {
-    std::vector<PlantRange> mapped_ranges;
+    constexpr size_t N_SEED_RANGES{ 100000u };
+    constexpr size_t N_MAPPINGS{ 1000u };
+    InputDataDay5_2 almanac = get_synthetic_almanac(N_SEED_RANGES, N_MAPPINGS, 5u);
 
-    while (src_range.start_val < src_range.end_val) 
+    auto compose_res = funcTime<PiecewiseLinearMap>(get_seed_to_location_map, almanac.planting_maps);
+    const PiecewiseLinearMap &seed_to_location = compose_res.second;
+    std::cout << "Composing " << N_MAPPINGS << " mappings per stage: " << seed_to_location.get_segment_num()
+        << " segments in " << compose_res.first << " ns" << std::endl;
+
+    const size_t max_threads{ std::max(1u, std::thread::hardware_concurrency()) };
+    for (size_t n_threads=1; n_threads<=max_threads; n_threads*=2u)
     {
-        PlantRange new_mapped_range{};
-        // map is sorted in ascending order -> the key before result of upper_bound() is the interesting one
-        auto upper_range = src_range_map.upper_bound(src_range.start_val);
+        auto res = funcTime<PlantNum>(get_min_location, seed_to_location, almanac.seed_ranges, n_threads);
+        std::cout << N_SEED_RANGES << " seed ranges with " << n_threads << " thread(s): " << res.second << " in " << res.first << " ns" << std::endl;
+    }
+}
 
-        if (upper_range != src_range_map.begin())
-        {
-            auto lower_range = upper_range;
-            --lower_range;
-            auto mapping_len = lower_range->second.second;
-            auto mapping_end_val = lower_range->first + mapping_len-1;
-            auto dst_start = lower_range->second.first;
-            auto mapping_start = lower_range->first;
-
-            if (src_range.start_val < mapping_end_val) // src_range.start_val is a mapped value
-            {
-                // map start value
-                new_mapped_range.start_val = dst_start + (src_range.start_val - mapping_start);
-                // end value is the smaller value of either mapping range or src_range
-                auto src_end_val = src_range.end_val < mapping_end_val ? src_range.end_val : mapping_end_val;
-                new_mapped_range.end_val = dst_start + (src_end_val - mapping_start);
-                mapped_ranges.push_back(new_mapped_range);
-                // adapt src_range.start_val
-                src_range.start_val = src_end_val+1;
-            }
-            else
-            { // src_range is not inside lower_range but starts after lower_range and before upper_range (might be end())
-                if (upper_range == src_range_map.end()) // src_range starts after any mapping range
-                {
-                    mapped_ranges.push_back(src_range);
-                    return mapped_ranges;
-                }
-                new_mapped_range.start_val = src_range.start_val;
-
-                // end is the smaller value of either 
-                auto src_end_val = src_range.end_val < upper_range->first ? src_range.end_val : upper_range->first-1;
-                new_mapped_range.end_val = src_end_val;
-                mapped_ranges.push_back(new_mapped_range);
-                src_range.start_val = src_end_val+1;
-            }
-        }
-        else
+std::vector<PlantNum> get_seed_locations(const InputDataDay5_1 &input_data)
+{
+    std::vector<PlantNum> dst_locations{ input_data.seed_nums };
+    PiecewiseLinearMap seed_to_location = get_seed_to_location_map(input_data.planting_maps);
+
+    seed_to_location.map_many(dst_locations);
+
+    return dst_locations;
+}
+
+/*
+Idea: each planting map is a piecewise linear function with slope 1, so the chain seed -> ... -> location is one as well.
+The maps are composed once, afterwards each seed (range) needs a single binary search instead of one lookup per stage.
+All maps share the same domain [0,domain_end), which is closed under every mapping.
+*/
+PiecewiseLinearMap get_seed_to_location_map(const std::map<std::string,PlantingMap> &planting_maps)
+{
+    PlantNum domain_end{ 0u };
+    for (const auto &[name, planting_map] : planting_maps)
+    {
+        for (size_t i=0; i<planting_map.src_starts.size(); ++i)
         {
-            // src_range.start_val is before any mapping ranges -> end of new range is either end of current src_range or start of a mapping
-            new_mapped_range.start_val = src_range.start_val;
-            auto src_end_val = src_range.end_val < upper_range->first ? src_range.end_val : upper_range->first-1;
-            new_mapped_range.end_val = src_end_val;
-            mapped_ranges.push_back(new_mapped_range);
-            src_range.start_val = src_end_val+1;
+            domain_end = std::max({ domain_end, planting_map.src_starts[i] + planting_map.ranges[i], planting_map.dst_starts[i] + planting_map.ranges[i] });
         }
     }
 
-    return mapped_ranges;
+    std::string cur_name = "seed";
+    const PlantingMap &first_map = planting_maps.at(cur_name);
+    PiecewiseLinearMap composed_map(first_map, domain_end);
+    cur_name = first_map.dst_type_name;
+    while (cur_name != "location")
+    {
+        const PlantingMap &cur_mapping = planting_maps.at(cur_name);
+        composed_map = composed_map.compose(PiecewiseLinearMap(cur_mapping, domain_end));
+        cur_name = cur_mapping.dst_type_name;
+    }
+
+    return composed_map;
 }
 
-std::vector<PlantNum> get_seed_locations(const InputDataDay5_1 &input_data)
+PiecewiseLinearMap::PiecewiseLinearMap(const PlantingMap &planting_map, PlantNum end_num) : domain_end{ end_num }
 {
-    std::vector<PlantNum> dst_locations;
-    auto &seeds_vec = input_data.seed_nums;
-    auto &plant_mappings = input_data.planting_maps;
+    PlantNum cur_start{ 0u };
+    for (size_t i=0; i<planting_map.src_starts.size(); ++i)
+    {
+        const PlantNum src_start{ planting_map.src_starts[i] };
+        if (src_start > cur_start) add_segment(cur_start, 0u); // gap between mapping ranges is the identity
+        add_segment(src_start, planting_map.dst_starts[i] - src_start);
+        cur_start = src_start + planting_map.ranges[i];
+    }
+    add_segment(cur_start, 0u);
+    add_segment(domain_end, 0u);
+}
 
+/**
+ * @brief Returns the map next_map(this(v)), the result only has breakpoints where one of both maps has a breakpoint
+ */
+PiecewiseLinearMap PiecewiseLinearMap::compose(const PiecewiseLinearMap &next_map) const
+{
+    PiecewiseLinearMap composed_map(domain_end);
 
-    for (auto seed : seeds_vec)
+    // values >= domain_end are mapped to themselves by both maps
+    for (size_t i=0; i<breakpoints.size() && breakpoints[i]<domain_end; ++i)
     {
-        std::string cur_name = "seed";
-        PlantNum mapped_val{ seed };
-        while (cur_name != "location")
+        PlantNum cur_start{ breakpoints[i] };
+        const PlantNum seg_end{ i+1<breakpoints.size() ? std::min(breakpoints[i+1], domain_end) : domain_end };
+        while (cur_start < seg_end)
         {
-            auto &cur_mapping = plant_mappings.at(cur_name);
-            auto nxt_target_type_name = cur_mapping.dst_type_name;
+            // split the segment at each breakpoint of next_map within its image
+            const PlantNum mapped_start{ cur_start + offsets[i] };
+            const size_t next_idx{ next_map.get_segment_idx(mapped_start) };
+            composed_map.add_segment(cur_start, offsets[i] + next_map.offsets[next_idx]);
+            if (next_idx+1 == next_map.breakpoints.size()) break;
+            cur_start += std::min(seg_end - cur_start, next_map.breakpoints[next_idx+1] - mapped_start);
+        }
+    }
+    composed_map.add_segment(domain_end, 0u);
 
-            mapped_val = cur_mapping.get_mapped_num(mapped_val);
+    return composed_map;
+}
 
-            cur_name = nxt_target_type_name;
-        }
-        dst_locations.push_back(mapped_val);
+PlantNum PiecewiseLinearMap::get_mapped_num(PlantNum src_num) const
+{
+    return src_num + offsets[get_segment_idx(src_num)];
+}
+
+/**
+ * @brief Returns the smallest mapped value of all numbers in src_range (inclusive end).
+ * Within a segment the mapping is increasing, so only the first value of each covered segment has to be checked.
+ */
+PlantNum PiecewiseLinearMap::get_min_mapped_num(PlantRange src_range) const
+{
+    PlantNum min_mapped_num{ std::numeric_limits<PlantNum>::max() };
+
+    PlantNum cur_start{ src_range.start_val };
+    for (size_t i=get_segment_idx(cur_start); i<breakpoints.size(); ++i)
+    {
+        min_mapped_num = std::min(min_mapped_num, cur_start + offsets[i]);
+        if (i+1 == breakpoints.size() || breakpoints[i+1] > src_range.end_val) break;
+        cur_start = breakpoints[i+1];
     }
 
-    return dst_locations;
+    return min_mapped_num;
 }
 
-PlantNum PlantingMap::get_mapped_num(PlantNum src_num) const
+/**
+ * @brief Maps all numbers in place. Blocks of BATCH_SIZE numbers are searched simultaneously: the number of search
+ * steps only depends on the number of segments, so each step is a short loop without branches over the whole
+ * block, which the compiler can vectorize and which keeps several independent loads in flight.
+ */
+void PiecewiseLinearMap::map_many(std::vector<PlantNum> &src_nums) const
 {
-    
-    // map is sorted in ascending order -> the key before result of upper_bound() is the interesting one
-    auto upper_elem = src_range_map.upper_bound(src_num);
+    constexpr size_t BATCH_SIZE{ 8u };
+    const PlantNum *bp = breakpoints.data();
 
-    if (upper_elem != src_range_map.begin())
+    size_t i{ 0u };
+    for (; i+BATCH_SIZE<=src_nums.size(); i+=BATCH_SIZE)
     {
-        --upper_elem;
-        auto range = upper_elem->second.second;
-        auto dst_start = upper_elem->second.first;
-        if (src_num < upper_elem->first + range) // src_num is a mapped value
+        PlantNum *batch = src_nums.data() + i;
+        std::array<size_t,BATCH_SIZE> base{};
+        for (size_t n=breakpoints.size(); n>1u; n-=n/2u)
         {
-            return dst_start + (src_num-upper_elem->first);
+            const size_t half{ n/2u };
+            for (size_t k=0; k<BATCH_SIZE; ++k)
+            {
+                base[k] = (bp[base[k]+half] <= batch[k]) ? base[k]+half : base[k];
+            }
         }
+        for (size_t k=0; k<BATCH_SIZE; ++k)
+        {
+            batch[k] += offsets[base[k]];
+        }
+    }
+    for (; i<src_nums.size(); ++i)
+    {
+        src_nums[i] = get_mapped_num(src_nums[i]);
     }
+}
 
-    // in all other cases src_num is not a mapped value -> return src_num
-    return src_num;
+/**
+ * @brief Branchless binary search for the last breakpoint <= src_num (breakpoints[0] is 0, so it always exists)
+ */
+size_t PiecewiseLinearMap::get_segment_idx(PlantNum src_num) const
+{
+    const PlantNum *bp = breakpoints.data();
+    size_t base{ 0u };
+    for (size_t n=breakpoints.size(); n>1u; n-=n/2u)
+    {
+        const size_t half{ n/2u };
+        base = (bp[base+half] <= src_num) ? base+half : base;
+    }
+    return base;
 }
 
+void PiecewiseLinearMap::add_segment(PlantNum start, PlantNum offset)
+{
+    // merge neighboring segments with the same offset and replace empty segments
+    if (!breakpoints.empty() && breakpoints.back() == start)
+    {
+        breakpoints.pop_back();
+        offsets.pop_back();
+    }
+    if (!offsets.empty() && offsets.back() == offset) return;
+    breakpoints.push_back(start);
+    offsets.push_back(offset);
+}
 
 PlantingMap create_planting_map(const std::string &map_str, const std::vector<std::string> &mapping_data)
 {
@@ -218,10 +397,19 @@ PlantingMap create_planting_map(const std::string &map_str, const std::vector<st
     auto dest_name = name_split[2].substr(0,name_split[2].length()-5); // remove last 5 letters ( map:)
     new_map.dst_type_name = dest_name;
 
+    // collect (src, dst, range) and store them sorted by source start
+    std::vector<std::array<PlantNum,3>> mappings;
     for (auto &elem : mapping_data)
     {
         auto num_vec = parse_string_to_number_vec<PlantNum>(elem);
-        new_map.src_range_map[num_vec[1]] = { num_vec[0], num_vec[2]};
+        mappings.push_back({ num_vec[1], num_vec[0], num_vec[2] });
+    }
+    std::sort(mappings.begin(), mappings.end());
+    for (const auto &[src_start, dst_start, range] : mappings)
+    {
+        new_map.src_starts.push_back(src_start);
+        new_map.dst_starts.push_back(dst_start);
+        new_map.ranges.push_back(range);
     }
 
     return new_map;
@@ -1,6 +1,5 @@
 #include <string>
 #include <array>
-#include <map>
 #include <algorithm>
 
 #include "../utility.h"
@@ -8,6 +7,17 @@
 
 using CamelLabel = int;
 using TBit = std::uint64_t;
+using THandKey = std::uint32_t;
+
+constexpr size_t HAND_SIZE{ 5u };
+constexpr unsigned LABEL_BITS{ 4u }; // labels are within [1,14]
+constexpr unsigned TYPE_SHIFT{ LABEL_BITS*HAND_SIZE }; // the hand type is stored in the nibble above all labels
+constexpr unsigned KEY_BITS{ TYPE_SHIFT + LABEL_BITS };
+constexpr unsigned RADIX_BITS{ 8u };
+constexpr THandKey LABEL_MASK{ (1u << LABEL_BITS) - 1u };
+constexpr THandKey JOKER{ 1u }; // label of J in part 2, no other card has this label
+constexpr size_t MAX_EQUAL_PAIRS{ HAND_SIZE*(HAND_SIZE-1u)/2u };
+constexpr size_t CLASSIFY_BATCH_SIZE{ 16u };
 
 // different type of hands with ascending order
 enum HandType
@@ -21,16 +31,34 @@ enum HandType
     FiveOfAKind
 };
 
+/*
+Hand types by number of jokers and number of equal pairs among the other cards: the pair count identifies the
+sorted label counts, e.g. 3 pairs are {3,1,1} for 5 cards but {3,1} for 4 cards, and each joker joins the
+largest group. Combinations that cannot occur are set to HighCard.
+*/
+constexpr std::array<std::array<HandType,MAX_EQUAL_PAIRS+1u>,HAND_SIZE+1u> TYPE_LUT{ {
+    //   0 pairs        1 pair         2 pairs        3 pairs        4 pairs     5 pairs   6 pairs      7-9 pairs                    10 pairs
+    { {  HighCard,      OnePair,       TwoPair,       ThreeOfAKind,  FullHouse,  HighCard, FourOfAKind, HighCard, HighCard, HighCard, FiveOfAKind } }, // 0 jokers
+    { {  OnePair,       ThreeOfAKind,  FullHouse,     FourOfAKind,   HighCard,   HighCard, FiveOfAKind } }, // 1 joker
+    { {  ThreeOfAKind,  FourOfAKind,   HighCard,      FiveOfAKind } }, // 2 jokers
+    { {  FourOfAKind,   FiveOfAKind } }, // 3 jokers
+    { {  FiveOfAKind } }, // 4 jokers
+    { {  FiveOfAKind } }  // 5 jokers
+} };
+
+// The key orders hands by type first and then by the labels from first to last card
 struct CamelCardHand
 {
-    std::vector<CamelLabel> hand;
+    THandKey key;
     TBit bit;
 
-    static HandType get_type(const CamelCardHand &hand_1);
+    static HandType get_type(THandKey label_key);
 };
 
-// comparator function for ordering hands 
-bool camel_hand_comparator(const CamelCardHand &hand_1, const CamelCardHand &hand_2);
+THandKey get_label_key(const std::string &cards, bool part_2);
+void add_hand_types(std::vector<CamelCardHand> &hands);
+void radix_sort_hands(std::vector<CamelCardHand> &hands);
+TBit get_total_winnings(std::vector<CamelCardHand> &hands);
 
 CamelLabel convert_to_camel_label(char c, bool part_2=false);
 std::vector<CamelCardHand> get_camel_card_input(const std::string& file_path, bool part_2=false);
@@ -38,103 +66,145 @@ std::vector<CamelCardHand> get_camel_card_input(const std::string& file_path, bo
 TBit sol_7_1(const std::string &file_path)
 {
     std::vector<CamelCardHand> camel_card_hands = get_camel_card_input(file_path);
-    std::sort(camel_card_hands.begin(), camel_card_hands.end(), camel_hand_comparator);
-
-    TBit winning{ 0 };
-
-    for (size_t i=0; i<camel_card_hands.size(); ++i)
-    {
-        winning += (i+1)*camel_card_hands[i].bit;
-    }
 
-    return winning;
+    return get_total_winnings(camel_card_hands);
 }
 
 
 TBit sol_7_2(const std::string &file_path)
 {
     std::vector<CamelCardHand> camel_card_hands = get_camel_card_input(file_path,true);
-    std::sort(camel_card_hands.begin(), camel_card_hands.end(), camel_hand_comparator);
 
-    TBit winning{ 0 };
+    return get_total_winnings(camel_card_hands);
+}
+
+TBit get_total_winnings(std::vector<CamelCardHand> &hands)
+{
+    radix_sort_hands(hands);
 
-    for (size_t i=0; i<camel_card_hands.size(); ++i)
+    TBit winning{ 0 };
+    for (size_t i=0; i<hands.size(); ++i)
     {
-        winning += (i+1)*camel_card_hands[i].bit;
+        winning += (i+1)*hands[i].bit;
     }
 
     return winning;
 }
 
-bool camel_hand_comparator(const CamelCardHand &hand_1, const CamelCardHand &hand_2)
+/*
+Idea: the key of each hand is computed once, so ordering the hands is a plain integer sort.
+LSD radix sort with RADIX_BITS per pass: counting the digits, turning the counts into start offsets and
+scattering the hands stably into a second buffer -> KEY_BITS/RADIX_BITS linear passes
+*/
+void radix_sort_hands(std::vector<CamelCardHand> &hands)
 {
-    auto type_1 = CamelCardHand::get_type(hand_1);
-    auto type_2 = CamelCardHand::get_type(hand_2);
-    if (type_1 == type_2) 
+    constexpr size_t N_BUCKETS{ size_t{ 1u } << RADIX_BITS };
+    constexpr THandKey DIGIT_MASK{ N_BUCKETS-1u };
+    std::vector<CamelCardHand> buffer(hands.size());
+
+    for (unsigned shift=0; shift<KEY_BITS; shift+=RADIX_BITS)
     {
-        for (size_t i=0; i<hand_1.hand.size(); ++i)
+        std::array<size_t,N_BUCKETS> offsets{};
+        for (const auto &hand : hands)
         {
-            if (hand_1.hand[i] != hand_2.hand[i]) return hand_1.hand[i] < hand_2.hand[i];
+            ++offsets[(hand.key >> shift) & DIGIT_MASK];
         }
-        throw std::runtime_error("camel_hand_comparator: Two hands are equal!");
-    } 
-    else
-    {
-        return type_1 < type_2;
+        size_t start{ 0u };
+        for (auto &offset : offsets)
+        {
+            const size_t count{ offset };
+            offset = start;
+            start += count;
+        }
+        for (const auto &hand : hands)
+        {
+            buffer[offsets[(hand.key >> shift) & DIGIT_MASK]++] = hand;
+        }
+        hands.swap(buffer);
     }
 }
 
-HandType CamelCardHand::get_type(const CamelCardHand &hand_1)
+/**
+ * @brief Packs the five labels into one key, first card in the most significant nibble
+ */
+THandKey get_label_key(const std::string &cards, bool part_2)
 {
-    std::map<CamelLabel,int> label_count_map;
-    int num_jokers{ 0 };
-    CamelLabel max_label{ };
-    int max_label_count{ 0 };
+    THandKey key{ 0u };
+    for (size_t i=0; i<HAND_SIZE; ++i)
+    {
+        key = (key << LABEL_BITS) | static_cast<THandKey>(convert_to_camel_label(cards[i], part_2));
+    }
+
+    return key;
+}
 
-    for (auto label : hand_1.hand)
+/*
+Idea: instead of counting labels in a map, count the equal pairs of non-joker cards (10 comparisons) and the jokers.
+Both counts together select the type in TYPE_LUT, which includes the joker promotion.
+The hands are processed in batches of CLASSIFY_BATCH_SIZE, where each step is the same operation for all
+hands of the batch without any branches, so the compiler can vectorize the comparisons.
+*/
+void add_hand_types(std::vector<CamelCardHand> &hands)
+{
+    size_t h{ 0u };
+    for (; h+CLASSIFY_BATCH_SIZE<=hands.size(); h+=CLASSIFY_BATCH_SIZE)
     {
-        if (label == 1) ++num_jokers;
-        else 
+        std::array<std::array<THandKey,CLASSIFY_BATCH_SIZE>,HAND_SIZE> labels{};
+        for (size_t c=0; c<HAND_SIZE; ++c)
         {
-            label_count_map[label] += 1;
-            if (label_count_map[label] > max_label_count)
+            for (size_t k=0; k<CLASSIFY_BATCH_SIZE; ++k)
             {
-                max_label_count = label_count_map[label];
-                max_label = label;
+                labels[c][k] = (hands[h+k].key >> (LABEL_BITS*(HAND_SIZE-1u-c))) & LABEL_MASK;
             }
         }
-    }
 
-    if (num_jokers > 0)
+        std::array<THandKey,CLASSIFY_BATCH_SIZE> n_jokers{};
+        std::array<THandKey,CLASSIFY_BATCH_SIZE> n_pairs{};
+        for (size_t c1=0; c1<HAND_SIZE; ++c1)
+        {
+            for (size_t k=0; k<CLASSIFY_BATCH_SIZE; ++k)
+            {
+                n_jokers[k] += static_cast<THandKey>(labels[c1][k] == JOKER);
+            }
+            for (size_t c2=c1+1u; c2<HAND_SIZE; ++c2)
+            {
+                for (size_t k=0; k<CLASSIFY_BATCH_SIZE; ++k)
+                {
+                    n_pairs[k] += static_cast<THandKey>((labels[c1][k] == labels[c2][k]) & (labels[c1][k] != JOKER));
+                }
+            }
+        }
+
+        for (size_t k=0; k<CLASSIFY_BATCH_SIZE; ++k)
+        {
+            hands[h+k].key |= static_cast<THandKey>(TYPE_LUT[n_jokers[k]][n_pairs[k]]) << TYPE_SHIFT;
+        }
+    }
+    for (; h<hands.size(); ++h)
     {
-        label_count_map[max_label] += num_jokers;
+        hands[h].key |= static_cast<THandKey>(CamelCardHand::get_type(hands[h].key)) << TYPE_SHIFT;
     }
+}
 
-    if (label_count_map.size() == 1) return HandType::FiveOfAKind;
-    if (label_count_map.size() == 2)
-    { // only two different labels 
-        if (label_count_map.begin()->second == 1 || label_count_map.begin()->second == 4) return HandType::FourOfAKind;
-        else return HandType::FullHouse;
-    }
-    else
+HandType CamelCardHand::get_type(THandKey label_key)
+{
+    size_t n_jokers{ 0u };
+    size_t n_pairs{ 0u };
+    for (size_t c1=0; c1<HAND_SIZE; ++c1)
     {
-        if (label_count_map.size() == 3)
-        { // three different labels -> three of a kind or two pairs
-            if (label_count_map.begin()->second == 2 || (++label_count_map.begin())->second == 2)
-            { // if one of the first two elements is a 2 -> two pairs
-                return HandType::TwoPair;
-            }
-            else
-            {
-                return HandType::ThreeOfAKind;
-            }
+        const THandKey label_1{ (label_key >> (LABEL_BITS*c1)) & LABEL_MASK };
+        if (label_1 == JOKER)
+        {
+            ++n_jokers;
+            continue;
         }
-        else
+        for (size_t c2=c1+1u; c2<HAND_SIZE; ++c2)
         {
-            if (label_count_map.size() == 4) return HandType::OnePair;
-            else return HandType::HighCard;
+            if (label_1 == ((label_key >> (LABEL_BITS*c2)) & LABEL_MASK)) ++n_pairs;
         }
     }
+
+    return TYPE_LUT[n_jokers][n_pairs];
 }
 
 std::vector<CamelCardHand> get_camel_card_input(const std::string& file_path, bool part_2)
@@ -150,15 +220,12 @@ std::vector<CamelCardHand> get_camel_card_input(const std::string& file_path, bo
         {
             CamelCardHand new_hand{};
             std::vector<std::string> hand_bit_split = split_string(input_line," ");
-            for (auto c : hand_bit_split[0]) 
-            {
-                CamelLabel c_label = convert_to_camel_label(c, part_2);
-                new_hand.hand.push_back(c_label);
-            }
+            new_hand.key = get_label_key(hand_bit_split[0], part_2);
             new_hand.bit = convert_to_num<TBit>(hand_bit_split[1]);
             camel_hands.push_back(new_hand);
         }
     }
+    add_hand_types(camel_hands);
 
     return camel_hands;
 }
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+/**
+ * \class CsrGraph<TLen,TVertex>
+ * \brief Immutable directed graph in compressed sparse row format.
+ *
+ * \tparam TLen     Type of edge lengths/weights
+ * \tparam TVertex  Integral type of vertex ids, vertices are numbered 0..num_vertices()-1
+ *
+ * \remark \parblock
+ * All outgoing edges of vertex v are stored consecutively in one packed (len,dst) array,
+ * `offsets[v]` is the index of the first edge of v and `offsets[v+1]` is one past its last edge.
+ * Iterating the neighbors of a vertex therefore is a linear walk over contiguous memory.
+ *
+ * Undirected graphs are represented by adding each edge in both directions.
+ * \endparblock
+ */
+template<typename TLen, typename TVertex=int>
+class CsrGraph
+{
+public:
+    struct Edge
+    {
+        TLen len{};
+        TVertex dst{};
+    };
+
+    // Edge as given to the constructor
+    struct InputEdge
+    {
+        TVertex src{};
+        TVertex dst{};
+        TLen len{};
+    };
+
+    // Range of the outgoing edges of a single vertex, usable in range-based for loops
+    struct EdgeRange
+    {
+        const Edge *first{ nullptr };
+        const Edge *last{ nullptr };
+        const Edge* begin() const { return first; }
+        const Edge* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    CsrGraph() : offsets(1u, 0u), edges{} {};
+    CsrGraph(size_t n_vertices, const std::vector<InputEdge> &input_edges);
+
+    size_t num_vertices() const { return offsets.size() - 1u; }
+    size_t num_edges() const { return edges.size(); }
+    size_t degree(TVertex v) const { return offsets[idx(v)+1u] - offsets[idx(v)]; }
+    EdgeRange neighbors(TVertex v) const { return { edges.data() + offsets[idx(v)], edges.data() + offsets[idx(v)+1u] }; }
+
+private:
+    static size_t idx(TVertex v) { return static_cast<size_t>(v); }
+
+    std::vector<size_t> offsets;
+    std::vector<Edge> edges;
+};
+
+/**
+ * @brief Builds the graph with a counting sort of the edges by source vertex,
+ * the order of the edges of a single vertex is the order in input_edges
+ *
+ * @param n_vertices number of vertices, all vertex ids have to be smaller
+ * @param input_edges directed edges (src, dst, len)
+ */
+template<typename TLen, typename TVertex>
+CsrGraph<TLen,TVertex>::CsrGraph(size_t n_vertices, const std::vector<InputEdge> &input_edges)
+    : offsets(n_vertices+1u, 0u), edges(input_edges.size())
+{
+    for (const auto &e : input_edges)
+    {
+        if (idx(e.src) >= n_vertices || idx(e.dst) >= n_vertices)
+        {
+            throw std::out_of_range("CsrGraph: Edge " + std::to_string(e.src) + " -> " + std::to_string(e.dst) +
+                " exceeds number of vertices " + std::to_string(n_vertices));
+        }
+        ++offsets[idx(e.src)+1u];
+    }
+    for (size_t v=0; v<n_vertices; ++v)
+    {
+        offsets[v+1u] += offsets[v];
+    }
+
+    std::vector<size_t> insert_pos(offsets.begin(), offsets.end()-1);
+    for (const auto &e : input_edges)
+    {
+        edges[insert_pos[idx(e.src)]++] = { e.len, e.dst };
+    }
+}
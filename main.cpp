@@ -25,6 +25,7 @@
 #include "24/sol_24.cpp"
 // #include "20/sol_20.cpp"
 #include <filesystem>
+#include <cstdlib>
 
 std::string get_input_file_name(int day)
 {
@@ -37,8 +38,60 @@ std::string get_input_file_name(int day)
     return "../" + std::to_string(day) + "/data.txt";
 }
 
-int main(int /*argc*/, char** /*argv*/)
+void print_usage()
 {
+    std::cout << "Usage: AoC_2020_main [options]\n"
+        << "  --help                 print this help and exit\n"
+        << "  --trace=<0..3>         runtime trace level, default is 0 (off)\n"
+        << "  --trace-file=<path>    write the trace output to a file instead of stdout\n"
+        << "  --strategy=<name>      longest path search of day 23: dfs, bnb (default), memo or bench.\n"
+        << "                         bench traces the timings of all strategies at --trace=1 or higher.\n"
+        << "                         Day 23 supports trail maps with at most 64 junctions including start and end,\n"
+        << "                         larger maps throw std::runtime_error\n"
+        << "  --bench_5=1            time day 5 part 2 on a synthetic almanac\n"
+        << "  --unfold_12=<n>        unfold factor of day 12 part 2, default is 5\n"
+        << "  --bench_12=1           time day 12 part 2 with each count type\n"
+        << "  --cross_check_21=1     compare the tiled step counter of day 21 against brute force\n"
+        << "  --<name>=<value>       any other option is stored for the solvers" << std::endl;
+}
+
+/**
+ * @brief Parses the optional command line arguments, --help prints all options (see print_usage)
+ * --trace=<0..3> sets the runtime trace level (see ETraceLevel), default is 0 (off)
+ * --trace-file=<path> redirects the trace output from stdout to a file
+ * --<name>=<value> any other option is stored for the solvers (see get_program_option),
+ *   e.g. --strategy=memo selects the longest path search of day 23,
+ *   --bench_5=1 times day 5 part 2 on a synthetic almanac
+ */
+void parse_args(int argc, char** argv)
+{
+    for (int i=1; i<argc; ++i)
+    {
+        std::string arg{ argv[i] };
+        if (arg == "--help")
+        {
+            print_usage();
+            std::exit(0);
+        }
+        else if (arg.rfind("--trace=", 0) == 0)
+        {
+            set_trace_level(static_cast<ETraceLevel>(std::stoi(arg.substr(8))));
+        }
+        else if (arg.rfind("--trace-file=", 0) == 0)
+        {
+            TraceSink::get().set_output_file(arg.substr(13));
+        }
+        else if (arg.rfind("--", 0) == 0 && arg.find('=') != std::string::npos)
+        {
+            auto sep = arg.find('=');
+            set_program_option(arg.substr(2, sep-2), arg.substr(sep+1));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    parse_args(argc, argv);
     /*
     std::cout << sol_1_1(get_input_file_name(1)) << std::endl;
     std::cout << sol_1_2(get_input_file_name(1)) << std::endl;
@@ -0,0 +1,15 @@
+# Runs FIRST and SECOND and fails if their outputs differ or one of them fails
+# usage: cmake -DFIRST=<exe> -DSECOND=<exe> -P compare_outputs.cmake
+
+execute_process(COMMAND ${FIRST} OUTPUT_VARIABLE FIRST_OUTPUT RESULT_VARIABLE FIRST_RESULT)
+execute_process(COMMAND ${SECOND} OUTPUT_VARIABLE SECOND_OUTPUT RESULT_VARIABLE SECOND_RESULT)
+
+if(NOT FIRST_RESULT EQUAL 0 OR NOT SECOND_RESULT EQUAL 0)
+    message(FATAL_ERROR "${FIRST} returned ${FIRST_RESULT}, ${SECOND} returned ${SECOND_RESULT}")
+endif()
+if(FIRST_OUTPUT STREQUAL "")
+    message(FATAL_ERROR "${FIRST} did not print anything")
+endif()
+if(NOT FIRST_OUTPUT STREQUAL SECOND_OUTPUT)
+    message(FATAL_ERROR "Outputs differ\n${FIRST}:\n${FIRST_OUTPUT}\n${SECOND}:\n${SECOND_OUTPUT}")
+endif()
@@ -0,0 +1,43 @@
+#include <iostream>
+#include "../20/sol_20.cpp"
+
+using namespace Day20;
+
+/*
+Driver for the day 20 tracking test: prints the changes of the modules in front of rx in a fixed order.
+It is built at -O0 and -O3 and both outputs have to be identical (see CMakeLists.txt).
+*/
+
+constexpr size_t BTN_PRESSES{ 10'000u };
+
+int main()
+{
+    ModuleConfig mod_config(read_string_vec_from_file(std::string{ DIR_PATH } + "/20/data.txt"));
+
+    std::vector<std::string> tracked_modules{ mod_config.get_inputs("rx") };
+    for (size_t level=0; level<2u; ++level)
+    {
+        std::vector<std::string> inputs{};
+        for (const auto &m : tracked_modules)
+        {
+            auto m_inputs = mod_config.get_inputs(m);
+            inputs.insert(inputs.end(), m_inputs.begin(), m_inputs.end());
+        }
+        tracked_modules.insert(tracked_modules.end(), inputs.begin(), inputs.end());
+    }
+    std::sort(tracked_modules.begin(), tracked_modules.end());
+    tracked_modules.erase(std::unique(tracked_modules.begin(), tracked_modules.end()), tracked_modules.end());
+
+    auto change_tracker = mod_config.track_changes(BTN_PRESSES, tracked_modules);
+    for (const auto &m : tracked_modules)
+    {
+        const auto &changes = change_tracker.at(m);
+        std::cout << m << " " << static_cast<int>(changes.first) << ":";
+        for (auto press : changes.second)
+        {
+            std::cout << " " << press;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
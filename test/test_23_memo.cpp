@@ -0,0 +1,97 @@
+#include <iostream>
+#include "../23/sol_23.cpp"
+
+using namespace Day23;
+
+/*
+Regression tests for the longest path search of day 23: the memoized search orients the ring edges of grid 
+shaped junction graphs, any other graph has to give the same result as the exhaustive DFS.
+*/
+
+const std::vector<std::string> EXAMPLE_MAP{
+        "#.#####################",
+        "#.......#########...###",
+        "#######.#########.#.###",
+        "###.....#.>.>.###.#.###",
+        "###v#####.#v#.###.#.###",
+        "###.>...#.#.#.....#...#",
+        "###v###.#.#.#########.#",
+        "###...#.#.#.......#...#",
+        "#####.#.#.#######.#.###",
+        "#.....#.#.#.......#...#",
+        "#.#####.#.#.#########v#",
+        "#.#...#...#...###...>.#",
+        "#.#.#v#######v###.###v#",
+        "#...#.>.#...>.>.#.###.#",
+        "#####v#.#.###v#.#.###.#",
+        "#.....#...#...#.#.#...#",
+        "#.#########.###.#.#.###",
+        "#...###...#...#...#.###",
+        "###.###.#.###v#####v###",
+        "#...#...#.#.>.>.#.>.###",
+        "#.###.###.#.###.#.#v###",
+        "#.....###...###...#...#",
+        "#####################.#"
+};
+
+CompactGraph get_test_graph(const std::vector<std::pair<TVId,TVId>> &edges, TVId n_vertices, bool is_directed)
+{
+    std::vector<TGraph::InputEdge> input_edges;
+    for (const auto &e : edges)
+    {
+        input_edges.push_back({ e.first, e.second, 1 });
+        if (!is_directed) input_edges.push_back({ e.second, e.first, 1 });
+    }
+    return get_compact_graph(TGraph(n_vertices, input_edges), n_vertices-1);
+}
+
+CompactGraph get_example_graph(bool part_1)
+{
+    auto start_end_pair = get_start_end_pos(EXAMPLE_MAP);
+    return get_compact_graph(reduce_to_graph(EXAMPLE_MAP, start_end_pair.first, start_end_pair.second, part_1), start_end_pair.second);
+}
+
+// Compares memo with DFS and the expected length, prints the failed case
+int check_longest_path(const std::string &name, const CompactGraph &g, int expected_len, bool expected_grid)
+{
+    const int len_dfs{ get_longest_path_dfs(g, 0, TVisited{ 1u }, 0) };
+    const int len_memo{ get_longest_path_memo(g) };
+    const bool is_grid{ is_perimeter_grid(g) };
+    if (len_dfs == expected_len && len_memo == expected_len && is_grid == expected_grid) return 0;
+
+    std::cout << name << ": dfs " << len_dfs << ", memo " << len_memo << ", expected " << expected_len 
+        << ", grid " << is_grid << ", expected " << expected_grid << std::endl;
+    return 1;
+}
+
+int main()
+{
+    int n_failed{ 0 };
+
+    // not grid shaped, orienting the ring edges would cut off the longest path
+    const std::vector<std::pair<TVId,TVId>> edges{ {0,1}, {1,2}, {1,4}, {2,3}, {3,4}, {4,5} };
+    n_failed += check_longest_path("directed", get_test_graph(edges, 6, true), 5, false);
+    n_failed += check_longest_path("undirected", get_test_graph(edges, 6, false), 5, false);
+
+    // the example is a 3x3 grid with cut corners in part 2, the slopes make part 1 directed
+    n_failed += check_longest_path("example part 1", get_example_graph(true), 94, false);
+    CompactGraph example_g = get_example_graph(false);
+    n_failed += check_longest_path("example part 2", example_g, 154, true);
+
+    // near grid: an additional edge into end, with oriented ring edges the longest path would be 154
+    std::vector<TGraph::InputEdge> near_grid_edges;
+    for (TVId v=0; v<static_cast<TVId>(example_g.n_vertices); ++v)
+    {
+        for (const auto &e : example_g.graph.neighbors(v))
+        {
+            near_grid_edges.push_back({ v, e.dst, e.len });
+        }
+    }
+    const TVId far_id{ 7 };
+    near_grid_edges.push_back({ far_id, example_g.end_id, 10 });
+    near_grid_edges.push_back({ example_g.end_id, far_id, 10 });
+    CompactGraph near_grid_g = get_compact_graph(TGraph(example_g.n_vertices, near_grid_edges), example_g.end_id);
+    n_failed += check_longest_path("near grid", near_grid_g, 159, false);
+
+    return n_failed;
+}
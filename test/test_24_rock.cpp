@@ -0,0 +1,50 @@
+#include <iostream>
+#include "../24/sol_24.cpp"
+
+using namespace Day24;
+
+/*
+Tests of day 24 on the example: crossings within [7,27] and the rock throw 24, 13, 10 @ -3, 1, 2
+*/
+
+const std::vector<HailState> EXAMPLE_STATES{
+    { { 19, 13, 30 }, { -2,  1, -2 } },
+    { { 18, 19, 22 }, { -1, -1, -2 } },
+    { { 20, 25, 34 }, { -2, -2, -4 } },
+    { { 12, 31, 28 }, { -1, -2, -1 } },
+    { { 20, 19, 15 }, {  1, -5, -3 } }
+};
+const HailState EXAMPLE_ROCK{ { 24, 13, 10 }, { -3, 1, 2 } };
+
+bool is_equal(const HailState &s1, const HailState &s2)
+{
+    return s1.p.x == s2.p.x && s1.p.y == s2.p.y && s1.p.z == s2.p.z && s1.v.x == s2.v.x && s1.v.y == s2.v.y && s1.v.z == s2.v.z;
+}
+
+int main()
+{
+    int n_failed{ 0 };
+    auto check = [&n_failed](const std::string &name, bool is_ok)
+    {
+        if (is_ok) return;
+        std::cout << name << " failed" << std::endl;
+        ++n_failed;
+    };
+
+    check("crossings", count_crossings_in_area(EXAMPLE_STATES, 7, 27, 1u) == 2);
+
+    std::array<TWide,N_UNKNOWNS> solution{};
+    const bool is_solved{ solve_modulo_prime(get_rock_equations(EXAMPLE_STATES[0], EXAMPLE_STATES[1], EXAMPLE_STATES[2]), solution) };
+    const std::array<TWide,N_UNKNOWNS> expected_solution{ 24, 13, 10, -3, 1, 2 };
+    check("equations", is_solved && solution == expected_solution);
+
+    const HailState rock = get_rock_throw(EXAMPLE_STATES);
+    check("rock throw", is_equal(rock, EXAMPLE_ROCK) && rock.p.x + rock.p.y + rock.p.z == 47);
+
+    // same velocity as a hailstone, but a different position: never hits it
+    check("parallel miss", !does_hit_all({ { 20, 25, 33 }, { -2, -2, -4 } }, { EXAMPLE_STATES[2] }));
+    check("parallel hit", does_hit_all(EXAMPLE_STATES[2], { EXAMPLE_STATES[2] }));
+    check("all hit", does_hit_all(EXAMPLE_ROCK, EXAMPLE_STATES));
+
+    return n_failed;
+}
@@ -5,12 +5,110 @@
 #include <fstream>
 #include <utility>
 #include <chrono>
+#include <sstream>
+#include <memory>
+#include <map>
 
 typedef std::chrono::high_resolution_clock::time_point TimeVar;
 
 #define duration(a) std::chrono::duration_cast<std::chrono::nanoseconds>(a).count()
 #define timeNow() std::chrono::high_resolution_clock::now()
 
+// Maximum trace level compiled into the solvers, trace statements above this level are removed completely
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 3
+#endif
+
+/**
+ * @brief Writes a debug trace if it is enabled at compile time and at runtime (see set_trace_level)
+ * Traces are collected in a buffer and only written to the trace output when the buffer is full or 
+ * at program exit, so enabled traces do not flush the terminal/disk on every line
+ * e.g. TRACE(ETraceLevel::Debug, "pos: " << x << ", " << y << "\n");
+ */
+#define TRACE(level, expr) \
+    do { if (trace_enabled(level)) { TraceSink::get().stream() << expr; TraceSink::get().flush_if_full(); } } while (false)
+
+enum class ETraceLevel : int
+{
+    Off=0,
+    Info,    // single results and timings
+    Debug,   // intermediate results, e.g. 2D maps after processing
+    Verbose  // output inside hot loops, e.g. every step or pair
+};
+
+class TraceSink
+{
+public:
+    TraceSink(const TraceSink&) = delete;
+    TraceSink& operator=(const TraceSink&) = delete;
+    static TraceSink& get()
+    {
+        static TraceSink sink;
+        return sink;
+    }
+    std::ostream& stream() { return buffer; }
+    ETraceLevel level() const { return trace_level; }
+    void set_level(ETraceLevel lvl) { trace_level = lvl; }
+    void set_output_file(const std::string &file_path)
+    {
+        flush();
+        file_out = std::make_unique<std::ofstream>(file_path);
+        out = file_out.get();
+    }
+    void flush_if_full()
+    {
+        if (buffer.tellp() >= static_cast<std::streamoff>(BUFFER_SIZE)) flush();
+    }
+    void flush()
+    {
+        *out << buffer.str();
+        out->flush();
+        buffer.str("");
+    }
+    ~TraceSink() { flush(); }
+private:
+    static constexpr size_t BUFFER_SIZE{ 1u<<16 };
+    TraceSink() = default;
+    ETraceLevel trace_level{ ETraceLevel::Off }; // traces are opt-in
+    std::ostringstream buffer{};
+    std::unique_ptr<std::ofstream> file_out{};
+    std::ostream *out{ &std::cout };
+};
+
+constexpr bool trace_compiled(ETraceLevel level)
+{
+    return static_cast<int>(level) <= TRACE_LEVEL;
+}
+
+bool trace_enabled(ETraceLevel level)
+{
+    return trace_compiled(level) && level <= TraceSink::get().level();
+}
+
+void set_trace_level(ETraceLevel level)
+{
+    TraceSink::get().set_level(level);
+}
+
+// Solver specific options given on the command line as --<name>=<value>
+std::map<std::string,std::string>& get_program_options()
+{
+    static std::map<std::string,std::string> options;
+    return options;
+}
+
+void set_program_option(const std::string &name, const std::string &value)
+{
+    get_program_options()[name] = value;
+}
+
+std::string get_program_option(const std::string &name, const std::string &default_value)
+{
+    const auto &options = get_program_options();
+    auto it = options.find(name);
+    return it == options.end() ? default_value : it->second;
+}
+
 template<typename T>
 struct Point3D
 {